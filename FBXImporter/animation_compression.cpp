@@ -0,0 +1,366 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "animation_compression.h"
+#include "parallel_for.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANIMATION_COMPRESSION_SSE
+#endif
+
+// range of the three smallest components of a unit quaternion
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+static const int SMALLEST_THREE_MAX = 32767;
+// upper bound of frames between two keys, keeps the reduction linear in the number of frames
+static const int MAX_SEGMENT_LENGTH = 256;
+
+
+PackedQuat packQuat(const glm::quat& q)
+{
+	float c[4] = { q.x, q.y, q.z, q.w };
+	int largest = 0;
+	for (int i = 1; i < 4; i++){
+		if (fabs(c[i]) > fabs(c[largest]))
+			largest = i;
+	}
+	// q and -q are the same rotation so the dropped component is made positive
+	float sign = c[largest] < 0 ? -1.0f : 1.0f;
+	PackedQuat packedQuat;
+	int j = 0;
+	for (int i = 0; i < 4; i++){
+		if (i == largest)
+			continue;
+		float v = (c[i] * sign / SMALLEST_THREE_RANGE) * 0.5f + 0.5f;
+		int quantized = (int)floor(v * SMALLEST_THREE_MAX + 0.5f);
+		quantized = quantized < 0 ? 0 : (quantized > SMALLEST_THREE_MAX ? SMALLEST_THREE_MAX : quantized);
+		packedQuat.data[j++] = (unsigned short)quantized;
+	}
+	packedQuat.data[0] |= (unsigned short)((largest & 1) << 15);
+	packedQuat.data[1] |= (unsigned short)((largest >> 1) << 15);
+	return packedQuat;
+}
+
+
+glm::quat unpackQuat(const PackedQuat& packedQuat)
+{
+	int largest = (packedQuat.data[0] >> 15) | ((packedQuat.data[1] >> 15) << 1);
+	float c[4];
+	float sum = 0;
+	int j = 0;
+	for (int i = 0; i < 4; i++){
+		if (i == largest)
+			continue;
+		float v = ((packedQuat.data[j++] & 0x7FFF) / (float)SMALLEST_THREE_MAX * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+		c[i] = v;
+		sum += v * v;
+	}
+	c[largest] = sum < 1.0f ? sqrt(1.0f - sum) : 0.0f;
+	return glm::quat(c[3], c[0], c[1], c[2]);
+}
+
+
+static glm::quat nlerp(const glm::quat& a, const glm::quat& b, float t)
+{
+	glm::quat end = glm::dot(a, b) < 0 ? -b : b;
+	return glm::normalize(a * (1.0f - t) + end * t);
+}
+
+
+// angle between two unit quaternions from their chord length, acos of the dot product is too coarse for small angles
+static float angleBetween(const glm::quat& a, const glm::quat& b)
+{
+	float sign = glm::dot(a, b) < 0 ? -1.0f : 1.0f;
+	float dx = a.x - b.x * sign;
+	float dy = a.y - b.y * sign;
+	float dz = a.z - b.z * sign;
+	float dw = a.w - b.w * sign;
+	float halfChord = 0.5f * sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+	return 4.0f * asin(halfChord < 1.0f ? halfChord : 1.0f);
+}
+
+
+// maximum error of the frames [start, end] interpolated between the keys at start and end,
+// stops early once errorBound is exceeded
+template<typename ErrorFunc>
+static float segmentError(int start, int end, float errorBound, ErrorFunc& errorFunc)
+{
+	float maxError = 0;
+	for (int i = start; i <= end && maxError <= errorBound; i++){
+		maxError = std::max(maxError, errorFunc(start, end, i));
+	}
+	return maxError;
+}
+
+
+// greedily extends each segment while the linear interpolation of its end keys stays within the error bound,
+// errorFunc(start, end, i) returns the error of frame i interpolated between the keys start and end
+template<typename ErrorFunc>
+static void reduceKeys(int numFrames, float errorBound, ErrorFunc errorFunc, std::vector<int>& keyFrames, std::vector<unsigned char>& frameDeltas, float& maxError)
+{
+	keyFrames.push_back(0);
+	// constant track
+	float constantError = 0;
+	for (int i = 0; i < numFrames && constantError <= errorBound; i++){
+		constantError = std::max(constantError, errorFunc(0, 0, i));
+	}
+	if (constantError <= errorBound || numFrames == 1){
+		maxError = std::max(maxError, constantError);
+		return;
+	}
+	int start = 0;
+	while (start < numFrames - 1){
+		int end = start + 1;
+		while (end + 1 < numFrames && end + 1 - start <= MAX_SEGMENT_LENGTH && segmentError(start, end + 1, errorBound, errorFunc) <= errorBound){
+			end++;
+		}
+		maxError = std::max(maxError, segmentError(start, end, FLT_MAX, errorFunc));
+		keyFrames.push_back(end);
+		frameDeltas.push_back((unsigned char)(end - start - 1));
+		start = end;
+	}
+}
+
+
+static void compressTrack(JointFramesMap& animation, int trackIndex, float translationError, float rotationError,
+						  CompressedTrack& track, float& maxTranslationError, float& maxRotationError)
+{
+	int numFrames = animation.numFrames;
+	int numTracks = animation.getNumTracks();
+	// copy the frames of the track out of the interleaved buffer
+	std::vector<glm::vec3> translations(numFrames);
+	for (int i = 0; i < numFrames; i++){
+		translations[i] = animation.localTranslations[(size_t)i * numTracks + trackIndex];
+	}
+	std::vector<int> keyFrames;
+	reduceKeys(numFrames, translationError, [&](int start, int end, int i){
+		glm::vec3 value = translations[start];
+		if (end > start){
+			float t = (float)(i - start) / (end - start);
+			value += (translations[end] - translations[start]) * t;
+		}
+		return glm::length(value - translations[i]);
+	}, keyFrames, track.translationFrameDeltas, maxTranslationError);
+	for (size_t k = 0; k < keyFrames.size(); k++){
+		track.translations.push_back(translations[keyFrames[k]]);
+	}
+
+	// the error is measured against the quantized keys so it includes the quantization error
+	std::vector<glm::quat> originals(numFrames);
+	std::vector<PackedQuat> packed(numFrames);
+	std::vector<glm::quat> quantized(numFrames);
+	for (int i = 0; i < numFrames; i++){
+		originals[i] = glm::normalize(animation.localQuaternions[(size_t)i * numTracks + trackIndex]);
+		packed[i] = packQuat(originals[i]);
+		quantized[i] = unpackQuat(packed[i]);
+	}
+	keyFrames.clear();
+	reduceKeys(numFrames, rotationError, [&](int start, int end, int i){
+		glm::quat value = quantized[start];
+		if (end > start)
+			value = nlerp(quantized[start], quantized[end], (float)(i - start) / (end - start));
+		return angleBetween(value, originals[i]);
+	}, keyFrames, track.rotationFrameDeltas, maxRotationError);
+	for (size_t k = 0; k < keyFrames.size(); k++){
+		track.rotations.push_back(packed[keyFrames[k]]);
+	}
+}
+
+
+void compressJointFramesMap(JointFramesMap& animation, float translationError, float rotationError, int numThreads, CompressedJointFramesMap* compressed)
+{
+	compressed->numFrames = animation.numFrames;
+	compressed->frameTime = animation.frameTime;
+	compressed->jointNames = animation.jointNames;
+	int numJoints = animation.getNumTracks();
+	compressed->tracks.resize(numJoints);
+	std::vector<float> translationErrors(numJoints, 0.0f);
+	std::vector<float> rotationErrors(numJoints, 0.0f);
+	int numFrames = compressed->numFrames;
+	if (numFrames == 0)
+		return;
+	parallelFor(numJoints, numThreads, [&](int j){
+		compressTrack(animation, j, translationError, rotationError, compressed->tracks[j], translationErrors[j], rotationErrors[j]);
+	});
+	for (int j = 0; j < numJoints; j++){
+		compressed->maxTranslationError = std::max(compressed->maxTranslationError, translationErrors[j]);
+		compressed->maxRotationError = std::max(compressed->maxRotationError, rotationErrors[j]);
+	}
+}
+
+
+CompressedJointFramesMap::CompressedJointFramesMap()
+{
+	numFrames = 0;
+	frameTime = 0;
+	maxTranslationError = 0;
+	maxRotationError = 0;
+}
+
+
+size_t CompressedJointFramesMap::getNumBytes()
+{
+	size_t numBytes = sizeof(CompressedJointFramesMap);
+	for (size_t j = 0; j < tracks.size(); j++){
+		CompressedTrack& track = tracks[j];
+		numBytes += sizeof(CompressedTrack) + jointNames[j].size();
+		numBytes += track.translationFrameDeltas.size() + track.translations.size() * sizeof(glm::vec3);
+		numBytes += track.rotationFrameDeltas.size() + track.rotations.size() * sizeof(PackedQuat);
+	}
+	return numBytes;
+}
+
+
+// number of frames decompressed for all joints before moving on, keeps the written block in cache
+static const int DECOMPRESSION_BLOCK_SIZE = 32;
+
+// position of a decompression in a key reduced track
+struct TrackCursor{
+	size_t key;
+	int keyFrame;
+	bool decoded; // start and end hold the decoded rotation keys of the current segment
+	glm::quat start;
+	glm::quat end;
+};
+
+
+// moves the cursor to the key that starts the segment containing frame
+static void seekSegment(const std::vector<unsigned char>& frameDeltas, int frame, TrackCursor& cursor)
+{
+	cursor.key = 0;
+	cursor.keyFrame = 0;
+	cursor.decoded = false;
+	while (cursor.key < frameDeltas.size() && cursor.keyFrame + frameDeltas[cursor.key] + 1 <= frame){
+		cursor.keyFrame += frameDeltas[cursor.key] + 1;
+		cursor.key++;
+	}
+}
+
+
+static void decompressTranslations(const CompressedTrack& track, TrackCursor& cursor, int firstFrame, int lastFrame, float* out, int stride)
+{
+	int f = firstFrame;
+	while (f < lastFrame){
+		glm::vec3 a = track.translations[cursor.key];
+		glm::vec3 d(0.0f);
+		int segmentEnd = INT_MAX;
+		float invLength = 0;
+		if (cursor.key < track.translationFrameDeltas.size()){
+			int length = track.translationFrameDeltas[cursor.key] + 1;
+			d = track.translations[cursor.key + 1] - a;
+			segmentEnd = cursor.keyFrame + length;
+			invLength = 1.0f / length;
+		}
+		int end = std::min(segmentEnd, lastFrame);
+		for (; f < end; f++, out += stride){
+			float t = (f - cursor.keyFrame) * invLength;
+			out[0] = a.x + d.x * t;
+			out[1] = a.y + d.y * t;
+			out[2] = a.z + d.z * t;
+		}
+		if (f == segmentEnd){
+			cursor.keyFrame = segmentEnd;
+			cursor.key++;
+		}
+	}
+}
+
+
+// decodes the rotation keys of the segment at the cursor, the end key of the previous segment is reused as start key
+static void decodeRotationSegment(const CompressedTrack& track, TrackCursor& cursor)
+{
+	cursor.start = cursor.decoded ? cursor.end : unpackQuat(track.rotations[cursor.key]);
+	cursor.end = cursor.start;
+	if (cursor.key < track.rotationFrameDeltas.size())
+		cursor.end = unpackQuat(track.rotations[cursor.key + 1]);
+	cursor.decoded = true;
+}
+
+
+// every key is decoded once, the frames inside a segment are normalized linear interpolations
+static void decompressRotations(const CompressedTrack& track, TrackCursor& cursor, int firstFrame, int lastFrame, float* out, int stride)
+{
+	if (!cursor.decoded)
+		decodeRotationSegment(track, cursor);
+	int f = firstFrame;
+	while (f < lastFrame){
+		int segmentEnd = INT_MAX;
+		float invLength = 0;
+		if (cursor.key < track.rotationFrameDeltas.size()){
+			int length = track.rotationFrameDeltas[cursor.key] + 1;
+			segmentEnd = cursor.keyFrame + length;
+			invLength = 1.0f / length;
+		}
+		int end = std::min(segmentEnd, lastFrame);
+		const glm::quat& a = cursor.start;
+		glm::quat b = glm::dot(a, cursor.end) < 0 ? -cursor.end : cursor.end;
+#ifdef ANIMATION_COMPRESSION_SSE
+		__m128 qa = _mm_setr_ps(a.w, a.x, a.y, a.z);
+		__m128 qd = _mm_sub_ps(_mm_setr_ps(b.w, b.x, b.y, b.z), qa);
+		for (; f < end; f++, out += stride){
+			__m128 q = _mm_add_ps(qa, _mm_mul_ps(_mm_set1_ps((f - cursor.keyFrame) * invLength), qd));
+			__m128 sq = _mm_mul_ps(q, q);
+			sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+			sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+			_mm_storeu_ps(out, _mm_div_ps(q, _mm_sqrt_ps(sq)));
+		}
+#else
+		for (; f < end; f++, out += stride){
+			float t = (f - cursor.keyFrame) * invLength;
+			glm::quat q = glm::normalize(a * (1.0f - t) + b * t);
+			out[0] = q.w;
+			out[1] = q.x;
+			out[2] = q.y;
+			out[3] = q.z;
+		}
+#endif
+		if (f == segmentEnd){
+			cursor.keyFrame = segmentEnd;
+			cursor.key++;
+			decodeRotationSegment(track, cursor);
+		}
+	}
+}
+
+
+void CompressedJointFramesMap::decompress(int firstFrame, int lastFrame, float* translations, float* quaternions)
+{
+	int numJoints = (int)tracks.size();
+	std::vector<TrackCursor> translationCursors(numJoints);
+	std::vector<TrackCursor> rotationCursors(numJoints);
+	for (int j = 0; j < numJoints; j++){
+		seekSegment(tracks[j].translationFrameDeltas, firstFrame, translationCursors[j]);
+		seekSegment(tracks[j].rotationFrameDeltas, firstFrame, rotationCursors[j]);
+	}
+	for (int blockStart = firstFrame; blockStart < lastFrame; blockStart += DECOMPRESSION_BLOCK_SIZE){
+		int blockEnd = std::min(blockStart + DECOMPRESSION_BLOCK_SIZE, lastFrame);
+		size_t offset = (size_t)(blockStart - firstFrame) * numJoints;
+		for (int j = 0; j < numJoints; j++){
+			decompressTranslations(tracks[j], translationCursors[j], blockStart, blockEnd, translations + (offset + j) * 3, numJoints * 3);
+			decompressRotations(tracks[j], rotationCursors[j], blockStart, blockEnd, quaternions + (offset + j) * 4, numJoints * 4);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef ANIMATION_COMPRESSION_H_
+#define ANIMATION_COMPRESSION_H_
+#include <string>
+#include <vector>
+#include "joint_frames.h"
+
+// quaternion in smallest three encoding, the largest component is dropped and the
+// other three are quantized to 15 bit, its index is stored in the top bits of data[0] and data[1]
+struct PackedQuat{
+	unsigned short data[3];
+};
+
+PackedQuat packQuat(const glm::quat& q);
+glm::quat unpackQuat(const PackedQuat& packedQuat);
+
+// key reduced track of one joint, the first key is at frame 0 and the frame deltas store
+// the distance to the next key minus one, constant tracks have a single key
+struct CompressedTrack{
+	std::vector<unsigned char> translationFrameDeltas;
+	std::vector<glm::vec3> translations;
+	std::vector<unsigned char> rotationFrameDeltas;
+	std::vector<PackedQuat> rotations;
+};
+
+class CompressedJointFramesMap{
+	public:
+		CompressedJointFramesMap();
+		std::vector<std::string> jointNames;
+		std::vector<CompressedTrack> tracks;
+		int numFrames;
+		float frameTime;
+		float maxTranslationError; // measured maximum distance to the source frames
+		float maxRotationError; // measured maximum angle to the source frames in radians
+		size_t getNumBytes();
+		// writes the frames [firstFrame, lastFrame) as (frames, joints, 3) translations and (frames, joints, 4) wxyz quaternions
+		void decompress(int firstFrame, int lastFrame, float* translations, float* quaternions);
+};
+
+void compressJointFramesMap(JointFramesMap& animation, float translationError, float rotationError, int numThreads, CompressedJointFramesMap* compressed);
+
+#endif //ANIMATION_COMPRESSION_H_
\ No newline at end of file
@@ -34,9 +34,14 @@ https://www.gamedev.net/articles/programming/graphics/how-to-work-with-fbx-sdk-r
 #include <glm/gtc/quaternion.hpp> 
 #include <glm/gtx/quaternion.hpp>
 #include "fbx_geometry_loader.h"
+#include "geometry_data_cache.h"
+#include "mesh_optimization.h"
+#include "mesh_simplification.h"
+#include "parallel_for.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
-#include <queue>
+#include <unordered_set>
 
 using namespace fbxsdk;
 
@@ -47,15 +52,67 @@ FBXGeometryLoader::FBXGeometryLoader(){
 
 }
 FBXGeometryLoader::~FBXGeometryLoader(){
+	releaseScene();
+	// Destroy all objects created by the FBX SDK.
+	if (lSdkManager) lSdkManager->Destroy();
+}
+
+
+// the manager is created once and reused for every file loaded with this loader
+bool FBXGeometryLoader::initializeSdk(){
+	if (lSdkManager != NULL)
+		return true;
+	lSdkManager = FbxManager::Create();
+	if (!lSdkManager){
+		std::cout << "Unable to create FBX Manager" << std::endl;
+		return false;
+	}
+	//Create an IOSettings object. This object holds all import/export settings.
+	FbxIOSettings* ios = FbxIOSettings::Create(lSdkManager, IOSROOT);
+	lSdkManager->SetIOSettings(ios);
+	return true;
+}
+
+
+// destroys the scene of the last file together with all objects the importer created in it
+void FBXGeometryLoader::releaseScene(){
+	if (fbxScene != NULL){
+		fbxScene->Destroy(true);
+		fbxScene = NULL;
+	}
+	sceneNodes.clear();
+	animatedNodeIndices.clear();
+}
+
+
+// skips the parts of the file that are not needed by the enabled import phases
+void FBXGeometryLoader::configureImportSettings(){
+	FbxIOSettings* ios = lSdkManager->GetIOSettings();
+	bool meshes = options.importMeshes;
+	ios->SetBoolProp(IMP_FBX_MATERIAL, meshes);
+	ios->SetBoolProp(IMP_FBX_TEXTURE, meshes);
+	ios->SetBoolProp(IMP_FBX_EXTRACT_EMBEDDED_DATA, meshes);
+	ios->SetBoolProp(IMP_FBX_LINK, meshes); // skin deformers
+	ios->SetBoolProp(IMP_FBX_SHAPE, meshes); // blend shapes
+	ios->SetBoolProp(IMP_FBX_ANIMATION, options.importAnimations);
+	// never used by the importer
+	ios->SetBoolProp(IMP_FBX_GOBO, false);
+	ios->SetBoolProp(IMP_FBX_AUDIO, false);
+}
+
+
+// a load succeeds if it found meshes, or anything of the enabled phases if meshes are not imported
+static bool hasImportedData(GeometryDataList* geometryDataList, const LoadOptions& options){
+	if (options.importMeshes)
+		return geometryDataList->meshList.size() > 0;
+	return geometryDataList->skeleton != NULL || geometryDataList->animations.size() > 0 || geometryDataList->compressedAnimations.size() > 0;
 }
 
 
 //based on http://www.gamedev.net/page/resources/_/technical/graphics-programming-and-theory/how-to-work-with-fbx-sdk-r3582
-Joint* extractSkeletonDataNodeHierarchyRecursively(FbxNode* node, Skeleton* skeleton, std::string& parent, int depth) {
+static Joint* extractJointFromNode(FbxNode* node, Skeleton* skeleton, const std::string& parent, FbxTime time) {
     auto name = std::string(node->GetName());
 	FbxDouble3 t = node->LclTranslation.Get();
-    auto time = FbxTime();
-    time.SetFrame(0);
     FbxAMatrix localTransform = node->EvaluateLocalTransform(time);
     FbxQuaternion q = localTransform.GetQ();
 	Joint* joint = new Joint(skeleton);
@@ -65,30 +122,6 @@ Joint* extractSkeletonDataNodeHierarchyRecursively(FbxNode* node, Skeleton* skel
     joint->offset = glm::vec3(t.mData[0], t.mData[1], t.mData[2]);
     //change order from xyzw to wxyz
     joint->rotation = glm::quat(q.mData[3], q.mData[0], q.mData[1], q.mData[2]); 
-	skeleton->joints[name] = joint;
-
-    //Log::write((std::string)"add " + name + " to skeleton");
-	joint->index = skeleton->jointOrder.size(); //set it later based on lookup in cluster list
-	skeleton->jointOrder.push_back(joint->name);
-    int nChildren = node->GetChildCount();
-	for (int i = 0; i < nChildren; i++)
-	{
-        auto attribute = node->GetChild(i)->GetNodeAttribute();
-        if (attribute && attribute->GetAttributeType() == FbxNodeAttribute::EType::eSkeleton) {
-            auto c_joint = extractSkeletonDataNodeHierarchyRecursively(node->GetChild(i), skeleton, joint->name, depth + 1);
-            skeleton->joints[name]->children.push_back(c_joint);
-          }
-	}
-    if(nChildren < 1){
-        Joint* endSite = new Joint(skeleton);
-        endSite->name = name+"EndSite";
-        endSite->offset = glm::vec3();
-        endSite->rotation = glm::quat();
-        endSite->parent = name;
-        endSite->children = std::vector<Joint*>();
-        skeleton->joints[endSite->name] = endSite;
-        skeleton->joints[name]->children.push_back(endSite);
-    }
     return joint;
 }
 
@@ -119,180 +152,303 @@ void FBXGeometryLoader::extractTextureNamesFromNode(FbxNode* pNode, std::vector<
 	}
 }
 
+// Resolves the mapping and reference mode of a layer element once and copies its values into one
+// entry per polygon corner, reading the direct and index arrays through raw pointers.
+template<typename T, typename Value, typename Convert>
+static bool readCornerValues(FbxLayerElementTemplate<T>* element, const MeshBuffers& buffers, std::vector<int>& directIndices, std::vector<Value>& cornerValues, Convert convert){
+	if (element == NULL)
+		return false;
+	int cornerCount = buffers.cornerControlPoints.size();
+	directIndices.resize(cornerCount);
+	switch (element->GetMappingMode()){
+	case FbxLayerElement::eByControlPoint:
+		std::copy(buffers.cornerControlPoints.begin(), buffers.cornerControlPoints.end(), directIndices.begin());
+		break;
+	case FbxLayerElement::eByPolygonVertex:
+		for (int i = 0; i < cornerCount; i++)
+			directIndices[i] = i;
+		break;
+	case FbxLayerElement::eByPolygon:{
+		int cornerIndex = 0;
+		for (size_t iPolygon = 0; iPolygon < buffers.polygonSizes.size(); iPolygon++){
+			for (int iPolygonVertex = 0; iPolygonVertex < buffers.polygonSizes[iPolygon]; iPolygonVertex++)
+				directIndices[cornerIndex++] = iPolygon;
+		}
+		break;
+	}
+	case FbxLayerElement::eAllSame:
+		std::fill(directIndices.begin(), directIndices.end(), 0);
+		break;
+	default:
+		std::cout << "Error: unsupported mapping mode " << element->GetMappingMode() << std::endl;
+		return false;
+	}
+	if (element->GetReferenceMode() != FbxLayerElement::eDirect){
+		FbxLayerElementArrayTemplate<int>& indexArray = element->GetIndexArray();
+		int indexCount = indexArray.GetCount();
+		int* indexData = indexArray.GetLocked(FbxLayerElementArray::eReadLock);
+		for (int i = 0; i < cornerCount; i++){
+			int k = directIndices[i];
+			directIndices[i] = (indexData != NULL && k >= 0 && k < indexCount) ? indexData[k] : -1;
+		}
+		indexArray.Release(&indexData);
+	}
+	FbxLayerElementArrayTemplate<T>& directArray = element->GetDirectArray();
+	int directCount = directArray.GetCount();
+	T* directData = directArray.GetLocked(FbxLayerElementArray::eReadLock);
+	if (directData == NULL)
+		return false;
+	cornerValues.resize(cornerCount);
+	for (int i = 0; i < cornerCount; i++){
+		int k = directIndices[i];
+		cornerValues[i] = (k >= 0 && k < directCount) ? convert(directData[k]) : Value();
+	}
+	directArray.Release(&directData);
+	return true;
+}
+
+static UVCoord convertUV(const FbxVector2& uv){
+	return UVCoord(uv[0], uv[1]);
+}
+
 // sources: http://www.gamedev.net/topic/656345-texture-uvs-on-fbx-mesh-are-foo-bared/
 //  http://www.gamedev.net/topic/577127-fbx-sdkprolem-with-getting-coords-and-normals/
-GeometryData* FBXGeometryLoader::createGeometryDataFromMesh(FbxMesh* pMesh, bool& success){
-	
-	GeometryData* geometryData = new GeometryData();
+void FBXGeometryLoader::extractMeshBuffersFromMesh(FbxMesh* pMesh, MeshBuffers& buffers){
 	FbxVector4* controlPoints = pMesh->GetControlPoints();
-	FbxLayerElementUV* fbxLayerUV = pMesh->GetLayer(0)->GetUVs();
-    //FbxGeometryElementUV* fbxLayerUV = pMesh->GetElementUV(0);
-
-	if (fbxLayerUV == NULL){
-		std::cout << "No UV layers in mesh" << std::endl;
-		success = false;
-		return geometryData;
-	}
-	unsigned int ctrlPointCount = pMesh->GetControlPointsCount();
-	unsigned int polygonCount = pMesh->GetPolygonCount();
-    bool polyCountSet = false;
-	int countPolyVerts = 3;
-	int vertexCount = 0;
-    
+	int ctrlPointCount = pMesh->GetControlPointsCount();
+	buffers.controlPoints.resize(ctrlPointCount);
+	for (int i = 0; i < ctrlPointCount; i++){
+		buffers.controlPoints[i] = Vertex(controlPoints[i].mData[0], controlPoints[i].mData[1], controlPoints[i].mData[2]);
+	}
+	int polygonCount = pMesh->GetPolygonCount();
+	int cornerCount = pMesh->GetPolygonVertexCount();
+	int* polygonVertices = pMesh->GetPolygonVertices();
+	buffers.polygonSizes.resize(polygonCount);
 	for (int iPolygon = 0; iPolygon < polygonCount; iPolygon++) {
-		int tempCountPolyVerts = pMesh->GetPolygonSize(iPolygon);
-		if (tempCountPolyVerts < 3 && tempCountPolyVerts > 4 && tempCountPolyVerts != countPolyVerts && polyCountSet){
-			//Log::write((std::string) "Only triangles and quads are supported for now");
-			success = false;
-			return geometryData;
-		}
-		countPolyVerts = tempCountPolyVerts;
-		polyCountSet = true;
-		//TODO either map uvs to indices or map weights to vertices
-		for (unsigned iPolygonVertex = 0; iPolygonVertex < countPolyVerts; iPolygonVertex++) {
-            geometryData->indices.push_back(vertexCount);
-
-			int controlPointIndex = pMesh->GetPolygonVertex(iPolygon, iPolygonVertex);
-            auto vertex = Vertex(controlPoints[controlPointIndex].mData[0],
-                                 controlPoints[controlPointIndex].mData[1],
-                                 controlPoints[controlPointIndex].mData[2]);
-			geometryData->vertices.push_back(vertex);
-
-            auto normal = getNormal(pMesh, controlPointIndex, vertexCount);
-            geometryData->normals.push_back(normal);
-
-			auto uv = getUVCoordinate(pMesh, fbxLayerUV, controlPointIndex, iPolygon, iPolygonVertex);
-			geometryData->uvs.push_back(uv);
-
-            if (geometryData->originalIndexVertexMapping.find(controlPointIndex) == geometryData->originalIndexVertexMapping.end())
-                geometryData->originalIndexVertexMapping[controlPointIndex] = std::vector<int>();
-            geometryData->originalIndexVertexMapping[controlPointIndex].push_back(vertexCount);
-         
-            vertexCount++;
+		buffers.polygonSizes[iPolygon] = pMesh->GetPolygonSize(iPolygon);
+	}
+	buffers.cornerControlPoints.assign(polygonVertices, polygonVertices + cornerCount);
+
+	// the attribute columns are read once per layer element instead of once per corner
+	std::vector<int> directIndices;
+	readCornerValues(pMesh->GetElementVertexColor(0), buffers, directIndices, buffers.cornerColors, [](const FbxColor& c){
+		return Color(c.mRed, c.mGreen, c.mBlue, c.mAlpha);
+	});
+	if (!buffers.textured)
+		return;
+	int uvSetCount = pMesh->GetElementUVCount();
+	if (uvSetCount == 0){
+		std::cout << "No UV layers in mesh" << std::endl;
+		return;
+	}
+	buffers.hasUVs = readCornerValues(pMesh->GetElementUV(0), buffers, directIndices, buffers.cornerUVs, convertUV);
+	if (!buffers.hasUVs)
+		return;
+	buffers.uvSetNames.push_back(pMesh->GetElementUV(0)->GetName());
+	for (int i = 1; i < uvSetCount; i++){
+		std::vector<UVCoord> cornerUVs;
+		if (readCornerValues(pMesh->GetElementUV(i), buffers, directIndices, cornerUVs, convertUV)){
+			buffers.uvSetNames.push_back(pMesh->GetElementUV(i)->GetName());
+			buffers.cornerExtraUVs.push_back(std::move(cornerUVs));
 		}
 	}
-    geometryData->nPolyVertices = countPolyVerts;
-	if (countPolyVerts == 3)
-		geometryData->drawMode = 3;
-	else
-		geometryData->drawMode = 4;
-	success = true;
-	return geometryData;
-}
-
-Normal FBXGeometryLoader::getNormal(fbxsdk::FbxMesh* mesh, int controlPointIndex, int vertexCount) {
-    FbxLayer* layer0 = mesh->GetLayer(0);
-    FbxLayerElementNormal* normals = layer0->GetNormals();
-    float sign = -1;
-    Normal normal = Normal();
-    auto refMode = normals->GetReferenceMode();
-    switch (refMode){
-        case FbxGeometryElement::eDirect:
-        {
-            //auto n = normals->GetDirectArray().GetAt(controlPointIndex).mData;
-            auto n = normals->GetDirectArray().GetAt(vertexCount).mData;
-            normal = Normal(sign*n[0], sign*n[1], sign*n[2]);
-            break;
-        }
-        case FbxGeometryElement::eIndexToDirect:
-        {
-            int index = normals->GetIndexArray().GetAt(vertexCount);
-            auto n = normals->GetDirectArray().GetAt(index).mData;
-            normal = Normal(sign*n[0], sign*n[1], sign*n[2]);
-            break;
-        }case FbxGeometryElement::eIndex:
-        {
-            int index = normals->GetIndexArray().GetAt(vertexCount);
-            auto n = normals->GetDirectArray().GetAt(index).mData;
-            normal = Normal(sign*n[0], sign*n[1], sign*n[2]);
-            break;
-        }default: {
-            std::cout << "Error: unknow reference mode " << refMode  << std::endl;
-            break;
-        }
-       }
-     return normal;
+	// the normals are negated as before
+	if (!readCornerValues(pMesh->GetElementNormal(0), buffers, directIndices, buffers.cornerNormals, [](const FbxVector4& n){
+		return Normal(-n[0], -n[1], -n[2]);
+	})){
+		buffers.cornerNormals.assign(cornerCount, Normal());
+	}
+	readCornerValues(pMesh->GetElementTangent(0), buffers, directIndices, buffers.cornerTangents, [](const FbxVector4& t){
+		return Normal(t[0], t[1], t[2]);
+	});
 }
 
-UVCoord FBXGeometryLoader::getUVCoordinate(FbxMesh* pMesh, FbxGeometryElementUV* fbxLayerUV, int controlPointIndex, int iPolygon, int iPolygonVertex){
-	int UVIndex = -1;
-	FbxVector2 fbxUV;
-	switch (fbxLayerUV->GetMappingMode())
-	{
-	case FbxLayerElement::eByControlPoint:
-		UVIndex = controlPointIndex;
-		switch (fbxLayerUV->GetReferenceMode())
-		{
-		case FbxGeometryElement::eDirect:
-			fbxUV = fbxLayerUV->GetDirectArray().GetAt(UVIndex);
-			break;
-		case FbxGeometryElement::eIndexToDirect://the indices do not correspond so you have to first look up the index using a mapping
-			int id = fbxLayerUV->GetIndexArray().GetAt(UVIndex);
-			fbxUV = fbxLayerUV->GetDirectArray().GetAt(id);
-			break;
+void convertToOpenGLCoordinateSystem(FbxAMatrix& input){
+	FbxVector4 translation = input.GetT();
+	FbxVector4 rotation = input.GetR();
+	translation.Set(translation.mData[0], translation.mData[1], -translation.mData[2]); // This negate Z of Translation Component of the matrix
+	rotation.Set(-rotation.mData[0], -rotation.mData[1], rotation.mData[2]); // This negate X,Y of Rotation Component of the matrix
+	// These 2 lines finally set "input" to the eventual converted result
+	input.SetT(translation);
+	input.SetR(rotation);
+}
+
+
+// walks the scene graph once, so that the extraction phases only iterate the flat table
+void FBXGeometryLoader::buildSceneNodeTable(){
+	sceneNodes.clear();
+	animatedNodeIndices.clear();
+	std::vector<std::pair<FbxNode*, int>> nodeStack;
+	nodeStack.push_back(std::make_pair(fbxScene->GetRootNode(), -1));
+	while (!nodeStack.empty()){
+		FbxNode* node = nodeStack.back().first;
+		SceneNode entry;
+		entry.node = node;
+		entry.name = node->GetName();
+		entry.parentIndex = nodeStack.back().second;
+		entry.attributeTypes = 0;
+		entry.meshAttributeIndex = -1;
+		nodeStack.pop_back();
+		for (int i = 0; i < node->GetNodeAttributeCount(); i++){
+			FbxNodeAttribute::EType attributeType = node->GetNodeAttributeByIndex(i)->GetAttributeType();
+			entry.attributeTypes |= 1u << attributeType;
+			if (attributeType == FbxNodeAttribute::eMesh && entry.meshAttributeIndex == -1)
+				entry.meshAttributeIndex = i;
 		}
-		break;
-	case FbxLayerElement::eByPolygonVertex:
-		UVIndex = pMesh->GetTextureUVIndex(iPolygon, iPolygonVertex);//, FbxLayerElement::eTextureDiffuse
-		switch (fbxLayerUV->GetReferenceMode())
-		{
-		case FbxGeometryElement::eDirect:
-			fbxUV = fbxLayerUV->GetDirectArray().GetAt(UVIndex);
-			break;
-
-		case FbxGeometryElement::eIndexToDirect://for some reason it still means direct access in this case
-			/*int id = fbxLayerUV->GetIndexArray().GetAt(UVIndex);
-			fbxUV = fbxLayerUV->GetDirectArray().GetAt(id);*/
-			fbxUV = fbxLayerUV->GetDirectArray().GetAt(UVIndex);
-			break;
+		int nodeIndex = sceneNodes.size();
+		sceneNodes.push_back(entry);
+		// pushed in reverse to visit the children in their order
+		for (int childIdx = node->GetChildCount() - 1; childIdx >= 0; childIdx--) {
+			nodeStack.push_back(std::make_pair(node->GetChild(childIdx), nodeIndex));
 		}
-		//iUVIndex = pMesh->GetTextureUVIndex(iPolygon, iPolygonVertex, FbxLayerElement::eTextureDiffuse);
-		//break;
 	}
-    return UVCoord(fbxUV[0], fbxUV[1]);
+}
 
+// the curves of a layer are only searched when the layer is first sampled, so that opening a file
+// to read its meshes or skeleton does not test the curves of every node
+const std::vector<int>& FBXGeometryLoader::getAnimatedNodeIndices(FbxAnimLayer* animLayer){
+	auto it = animatedNodeIndices.find(animLayer);
+	if (it != animatedNodeIndices.end())
+		return it->second;
+	std::vector<int>& nodeIndices = animatedNodeIndices[animLayer];
+	for (size_t i = 0; i < sceneNodes.size(); i++){
+		FbxNode* node = sceneNodes[i].node;
+		if (node->LclTranslation.IsAnimated(animLayer) || node->LclRotation.IsAnimated(animLayer))
+			nodeIndices.push_back(i);
+	}
+	return nodeIndices;
 }
 
-//source: http://www.gamedev.net/topic/577127-fbx-sdkprolem-with-getting-coords-and-normals/
-GeometryData* FBXGeometryLoader::createColoredGeometryDataFromMesh(FbxMesh* pMesh, bool& success){
-	
-	GeometryData* geometryData = new GeometryData();
-	FbxVector4* fbxControlPoints = pMesh->GetControlPoints();
-	for (int i = 0; i < pMesh->GetControlPointsCount(); i++)
-	{
-		geometryData->vertices.push_back(Vertex(fbxControlPoints[i].mData[0],
-			fbxControlPoints[i].mData[1],
-			fbxControlPoints[i].mData[2]));
+void FBXGeometryLoader::sampleAnimatedNodes(std::vector<FbxNode*>& animatedNodes, JointFramesMap& animation, FbxTime start){
+	// one task per node, so that the curves of a node are only read by one thread, and every worker thread uses its own evaluator
+	int numFrames = animation.numFrames;
+	int numTracks = animation.getNumTracks();
+	double frameTime = animation.frameTime;
+	int numTasks = numFrames > 0 ? animatedNodes.size() : 0;
+	if (numTasks == 0)
+		return;
+	int numWorkers = getNumWorkerThreads(options.numThreads, numTasks);
+	std::vector<FbxAnimEvaluator*> evaluators(numWorkers);
+	evaluators[0] = fbxScene->GetAnimationEvaluator();
+	for (int i = 1; i < numWorkers; i++){
+		evaluators[i] = FbxAnimEvalClassic::Create(fbxScene, "");
 	}
+	parallelForWorkers(numTasks, numWorkers, [&](int track, int worker){
+		// the nodes were added as tracks in the same order
+		FbxNode* node = animatedNodes[track];
+		FbxAnimEvaluator* evaluator = evaluators[worker];
+		auto currentT = FbxTime();
+		for (int frameIdx = 0; frameIdx < numFrames; frameIdx++) {
+			currentT.SetSecondDouble(start.GetSecondDouble() + frameIdx * frameTime);
+			FbxAMatrix& localTransform = evaluator->GetNodeLocalTransform(node, currentT);
+			auto q = localTransform.GetQ();
+			auto t = localTransform.GetT();
+			size_t offset = (size_t)frameIdx * numTracks + track;
+			animation.localTranslations[offset] = glm::vec3(t[0], t[1], t[2]);
+			animation.localQuaternions[offset] = glm::quat(q[3], q[0], q[1], q[2]);
+		}
+	});
+	for (int i = 1; i < numWorkers; i++){
+		evaluators[i]->Destroy();
+	}
+}
 
-	for (int iPolygon = 0; iPolygon < pMesh->GetPolygonCount(); iPolygon++) {
-		for (unsigned iPolygonVertex = 0; iPolygonVertex < 3; iPolygonVertex++) {
-			int fbxCornerIndex = pMesh->GetPolygonVertex(iPolygon, iPolygonVertex);
-			geometryData->indices.push_back(fbxCornerIndex);
+bool isZero(const FbxVector4& v){
+	return v.mData[0] == 0 && v.mData[1] == 0 && v.mData[2] == 0;
+}
 
-		}
+// the curve keys describe the local transform only if no pivots, offsets, pre/post rotations or constraints modify it
+bool hasPlainLocalTransform(FbxNode* node){
+	return isZero(node->GetPreRotation(FbxNode::eSourcePivot))
+		&& isZero(node->GetPostRotation(FbxNode::eSourcePivot))
+		&& isZero(node->GetRotationOffset(FbxNode::eSourcePivot))
+		&& isZero(node->GetRotationPivot(FbxNode::eSourcePivot))
+		&& isZero(node->GetScalingOffset(FbxNode::eSourcePivot))
+		&& isZero(node->GetScalingPivot(FbxNode::eSourcePivot))
+		&& node->GetDstObjectCount<FbxConstraint>() == 0;
+}
+
+// copies the keys in [start, end) and the keys next to the window that are needed to interpolate at its borders
+void extractCurveKeys(FbxAnimCurve* curve, double defaultValue, FbxTime start, FbxTime end, std::vector<CurveKey>& keys){
+	int numKeys = curve != NULL ? curve->KeyGetCount() : 0;
+	int firstKey = 0;
+	while (firstKey + 1 < numKeys && !(start < curve->KeyGetTime(firstKey + 1))){
+		firstKey++;
+	}
+	int lastKey = firstKey;
+	while (lastKey + 1 < numKeys && curve->KeyGetTime(lastKey) < end){
+		lastKey++;
+	}
+	if (numKeys == 0){
+		CurveKey key;
+		key.time = 0;
+		key.value = defaultValue;
+		key.leftDerivative = 0;
+		key.rightDerivative = 0;
+		key.interpolation = FbxAnimCurveDef::eInterpolationConstant;
+		keys.push_back(key);
+		return;
 	}
+	keys.resize(lastKey - firstKey + 1);
+	for (int i = firstKey; i <= lastKey; i++){
+		CurveKey& key = keys[i - firstKey];
+		key.time = (curve->KeyGetTime(i) - start).GetSecondDouble();
+		key.value = curve->KeyGetValue(i);
+		key.leftDerivative = curve->KeyGetLeftDerivative(i);
+		key.rightDerivative = curve->KeyGetRightDerivative(i);
+		key.interpolation = curve->KeyGetInterpolation(i);
+	}
+}
 
-	geometryData->shaderName = "color";
-	geometryData->drawMode = 3;
-	Color color = Color(1, 0, 0, 1);
-	for (unsigned short i = 0; i < geometryData->vertices.size(); i++){
-		geometryData->colors.push_back(color);
+void extractJointCurves(FbxNode* node, FbxAnimLayer* animLayer, FbxTime start, FbxTime end, JointCurves& curves){
+	const char* components[3] = { FBXSDK_CURVENODE_COMPONENT_X, FBXSDK_CURVENODE_COMPONENT_Y, FBXSDK_CURVENODE_COMPONENT_Z };
+	FbxDouble3 t = node->LclTranslation.Get();
+	FbxDouble3 r = node->LclRotation.Get();
+	for (int i = 0; i < 3; i++){
+		extractCurveKeys(node->LclTranslation.GetCurve(animLayer, components[i]), t.mData[i], start, end, curves.channels[i]);
+		extractCurveKeys(node->LclRotation.GetCurve(animLayer, components[i]), r.mData[i], start, end, curves.channels[3 + i]);
 	}
+	EFbxRotationOrder rotationOrder = eEulerXYZ;
+	node->GetRotationOrder(FbxNode::eSourcePivot, rotationOrder);
+	curves.rotationOrder = rotationOrder;
+}
 
-	success = true;
-	return geometryData;
+// restricts the take [start, end) to the window [rangeStart, rangeEnd) in seconds relative to the take start, a negative rangeEnd keeps the end of the take
+static void clampToWindow(double rangeStart, double rangeEnd, FbxTime& start, FbxTime& end){
+	double takeStart = start.GetSecondDouble();
+	double takeEnd = end.GetSecondDouble();
+	if (rangeEnd >= 0 && takeStart + rangeEnd < takeEnd)
+		end.SetSecondDouble(takeStart + rangeEnd);
+	if (rangeStart > 0)
+		start.SetSecondDouble(takeStart + rangeStart);
 }
-void convertToOpenGLCoordinateSystem(FbxAMatrix& input){
-	FbxVector4 translation = input.GetT();
-	FbxVector4 rotation = input.GetR();
-	translation.Set(translation.mData[0], translation.mData[1], -translation.mData[2]); // This negate Z of Translation Component of the matrix
-	rotation.Set(-rotation.mData[0], -rotation.mData[1], rotation.mData[2]); // This negate X,Y of Rotation Component of the matrix
-	// These 2 lines finally set "input" to the eventual converted result
-	input.SetT(translation);
-	input.SetR(rotation);
+
+double FBXGeometryLoader::getSampleRate(){
+	double sampleRate = options.sampleRate;
+	if (sampleRate <= 0){
+		FbxGlobalSettings& globalSettings = fbxScene->GetGlobalSettings();
+		FbxTime::EMode timeMode = globalSettings.GetTimeMode();
+		sampleRate = timeMode == FbxTime::eCustom ? globalSettings.GetCustomFrameRate() : FbxTime::GetFrameRate(timeMode);
+	}
+	return sampleRate;
 }
 
+static int getNumFrames(FbxTime start, FbxTime end, double sampleRate){
+	// sample the frames in [start, end)
+	int numFrames = (int)std::ceil((end - start).GetSecondDouble() * sampleRate - 1e-6);
+	return numFrames < 0 ? 0 : numFrames;
+}
+
+void FBXGeometryLoader::restrictToTimeRange(const std::string& takeName, FbxTime& start, FbxTime& end){
+	double rangeStart = options.startTime;
+	double rangeEnd = options.endTime;
+	auto range = options.takeTimeRanges.find(takeName);
+	if (range != options.takeTimeRanges.end()){
+		rangeStart = range->second.first;
+		rangeEnd = range->second.second;
+	}
+	clampToWindow(rangeStart, rangeEnd, start, end);
+}
 
 bool FBXGeometryLoader::extractAnimations(GeometryDataList* geometryData){
 	//https://github.com/gameplay3d/GamePlay/blob/master/tools/encoder/src/FBXSceneEncoder.cpp
@@ -301,8 +457,8 @@ bool FBXGeometryLoader::extractAnimations(GeometryDataList* geometryData){
 	//std::cout << " extract animations" << std::endl;
 	std::string animationName;
 	std::string animKey;
-	std::string nodeName;
 	std::string layerName;
+	double sampleRate = getSampleRate();
 	for (int animIdx = 0; animIdx < fbxScene->GetSrcObjectCount<FbxAnimStack>(); animIdx++){
 		FbxAnimStack* currAnimStack = fbxScene->GetSrcObject<FbxAnimStack>(animIdx);
 		fbxScene->SetCurrentAnimationStack(currAnimStack);
@@ -312,6 +468,8 @@ bool FBXGeometryLoader::extractAnimations(GeometryDataList* geometryData){
 		FbxTakeInfo* takeInfo = fbxScene->GetTakeInfo(animStackName);
 		FbxTime start = takeInfo->mLocalTimeSpan.GetStart();
 		FbxTime end = takeInfo->mLocalTimeSpan.GetStop();
+		restrictToTimeRange(animationName, start, end);
+		int numFrames = getNumFrames(start, end, sampleRate);
 		int numLayers = currAnimStack->GetMemberCount<FbxAnimLayer>();
 
 		for (int layerIdx = 0; layerIdx  < numLayers; layerIdx++)
@@ -320,59 +478,50 @@ bool FBXGeometryLoader::extractAnimations(GeometryDataList* geometryData){
 			layerName = lAnimLayer->GetName();
 			animKey = animationName + layerName;
 			std::cout << "extract layer " << animKey << std::endl;
-			geometryData->animations[animKey] = JointFramesMap();
-			FbxNode* tempNode = fbxScene->GetRootNode();
-			std::queue<FbxNode*> nodeQueue;
-			while (tempNode != NULL)
-			{
-				//check if an animation curve exists
-				bool translation = tempNode->LclTranslation.IsAnimated(lAnimLayer);
-				bool rotation = tempNode->LclRotation.IsAnimated(lAnimLayer);
-				if (translation || rotation) {
-
-					//std::cout << " check if " << nodeName << "exists " << std::endl;
-					nodeName = tempNode->GetName();
-					//check if node name already exists
-					if (geometryData->animations[animKey].frames.find(nodeName) != geometryData->animations[animKey].frames.end()) {
-						continue;
-					}
-					//std::cout << " copy animation of node " << nodeName << std::endl;
-					geometryData->animations[animKey].frames[nodeName] = JointFrames();
-					auto currentT = FbxTime();
-					for (int frameIdx = start.GetFrameCount(FbxTime::eFrames24); frameIdx < end.GetFrameCount(FbxTime::eFrames24); frameIdx++) {
-						currentT.SetFrame(frameIdx, FbxTime::eFrames24);
-						auto localTransform = tempNode->EvaluateLocalTransform(currentT);
-						auto q = localTransform.GetQ();
-						auto t = localTransform.GetT();
-						geometryData->animations[animKey].frames[nodeName].localTranslation.push_back(glm::vec3(t[0], t[1], t[2]));
-						geometryData->animations[animKey].frames[nodeName].localQuaternions.push_back(glm::quat(q[3], q[0], q[1], q[2]));
-					}
-
-					//std::cout << " copied  " << geometryData->animations[animKey].frames[nodeName].localTranslation.size() << " frames" << std::endl;
+			JointFramesMap& animation = geometryData->animations[animKey];
+			animation = JointFramesMap();
+			animation.frameTime = 1.0 / sampleRate;
+			// collect the animated nodes first so that they can be sampled in parallel
+			std::vector<FbxNode*> animatedNodes;
+			std::unordered_set<std::string> trackNames;
+			const std::vector<int>& nodeIndices = getAnimatedNodeIndices(lAnimLayer);
+			for (auto it = nodeIndices.begin(); it != nodeIndices.end(); it++){
+				FbxNode* node = sceneNodes[*it].node;
+				const std::string& nodeName = sceneNodes[*it].name;
+				//check if node name already exists
+				if (trackNames.find(nodeName) != trackNames.end() || animation.curves.find(nodeName) != animation.curves.end()) {
+					continue;
 				}
-				for (int childIdx = 0; childIdx < tempNode->GetChildCount(); childIdx++) {
-					nodeQueue.push(tempNode->GetChild(childIdx));
-				}
-				tempNode = NULL;
-				if (!nodeQueue.empty()) {
-					tempNode = nodeQueue.front();
-					nodeQueue.pop();
+				// keys of a single layer only match the evaluated result if there are no other layers to blend
+				if (options.extractKeyframes && numLayers == 1 && hasPlainLocalTransform(node)){
+					extractJointCurves(node, lAnimLayer, start, end, animation.curves[nodeName]);
+					continue;
 				}
+				int jointIndex = geometryData->skeleton != NULL ? geometryData->skeleton->getJointIndex(nodeName) : -1;
+				animation.addTrack(nodeName, jointIndex);
+				trackNames.insert(nodeName);
+				animatedNodes.push_back(node);
+			}
+			animation.resizeFrames(numFrames);
+			sampleAnimatedNodes(animatedNodes, animation, start);
+			if (options.compressAnimations && animation.getNumTracks() > 0){
+				CompressedJointFramesMap* compressed = new CompressedJointFramesMap();
+				compressJointFramesMap(animation, options.translationErrorBound, options.rotationErrorBound, options.numThreads, compressed);
+				delete geometryData->compressedAnimations[animKey];
+				geometryData->compressedAnimations[animKey] = compressed;
+				// the sampled frames are only kept in compressed form
+				animation.clearFrames();
 			}
 		}
 	}
+	if (geometryData->skeleton != NULL && geometryData->animations.size() > 0){
+		geometryData->skeleton->frameTime = 1.0 / sampleRate;
+	}
 	return true;
 }
 
-void processSkin(FbxSkin* currSkin, FbxAMatrix& geometryTransform, GeometryData* geometryData) {
-	Skeleton* skeleton = geometryData->skeleton;
-	int numVertices = geometryData->vertices.size();
-	std::cout << "Extract weights for " << numVertices << "vertices" << std::endl;
-	// create empty joint weights
-	for (unsigned int vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) {
-		geometryData->jointWeights.push_back(VertexJointData());
-		//weights.push_back(false);
-	}
+void FBXGeometryLoader::extractSkinClusters(FbxSkin* currSkin, FbxAMatrix& geometryTransform, Skeleton* skeleton, MeshBuffers& buffers) {
+	buffers.hasSkin = true;
 	int numOfClusters = currSkin->GetClusterCount();
 	for (unsigned int clusterIndex = 0; clusterIndex < numOfClusters; clusterIndex++) {
 		FbxCluster* currCluster = currSkin->GetCluster(clusterIndex);
@@ -380,7 +529,8 @@ void processSkin(FbxSkin* currSkin, FbxAMatrix& geometryTransform, GeometryData*
 		FbxNode* jnode = currCluster->GetLink();
 		std::string name = jnode->GetName();
 
-		if (skeleton->joints.find(name) == skeleton->joints.end()) {
+		int jointIndex = skeleton->getJointIndex(name);
+		if (jointIndex < 0) {
 			//  Log::write((std::string)"skip " + name);
 			continue;
 		}
@@ -396,26 +546,22 @@ void processSkin(FbxSkin* currSkin, FbxAMatrix& geometryTransform, GeometryData*
 		FbxVector4 inverseTranslation = inverseBindPose.GetT();
 		auto m = glm::toMat4(glm::quat(inverseQuat[3], inverseQuat[0], inverseQuat[1], inverseQuat[2]));
 
-		skeleton->joints[name]->invBindPose = m;
-		skeleton->joints[name]->invBindPose[3][0] = inverseTranslation[0];
-		skeleton->joints[name]->invBindPose[3][1] = inverseTranslation[1];
-		skeleton->joints[name]->invBindPose[3][2] = inverseTranslation[2];
-		//extract weights
-		int jointIndex = skeleton->joints[name]->index;//get joint index from joint order
-
-		auto cluster_weights = currCluster->GetControlPointWeights();
-		for (unsigned int i = 0; i < currCluster->GetControlPointIndicesCount(); i++)
-		{
-			int controlPointIndex = currCluster->GetControlPointIndices()[i];
-			auto vertexList = geometryData->originalIndexVertexMapping[controlPointIndex];
-			for (auto it = vertexList.begin(); it != vertexList.end(); it++) {
-				geometryData->jointWeights[*it].addJointWeight(jointIndex, cluster_weights[i]);
-			}
-		}
+		glm::mat4& invBindPose = skeleton->inverseBindPoses[jointIndex];
+		invBindPose = m;
+		invBindPose[3][0] = inverseTranslation[0];
+		invBindPose[3][1] = inverseTranslation[1];
+		invBindPose[3][2] = inverseTranslation[2];
+		//copy weights, they are assigned to the vertices after the mesh conversion
+		SkinClusterBuffer cluster;
+		cluster.jointIndex = jointIndex;//get joint index from joint order
+		int numClusterIndices = currCluster->GetControlPointIndicesCount();
+		cluster.controlPointIndices.assign(currCluster->GetControlPointIndices(), currCluster->GetControlPointIndices() + numClusterIndices);
+		cluster.weights.assign(currCluster->GetControlPointWeights(), currCluster->GetControlPointWeights() + numClusterIndices);
+		buffers.skinClusters.push_back(cluster);
 	}
 }
 
-bool FBXGeometryLoader::extractSkeletonWeightsFromMeshNode(FbxMesh* mesh, GeometryData* geometryData){
+bool FBXGeometryLoader::extractSkinBuffersFromMesh(FbxMesh* mesh, Skeleton* skeleton, MeshBuffers& buffers){
 	//based on http://www.gamedev.net/page/resources/_/technical/graphics-programming-and-theory/how-to-work-with-fbx-sdk-r3582
 
 	mesh->GetNode()->GetTransform();
@@ -431,7 +577,7 @@ bool FBXGeometryLoader::extractSkeletonWeightsFromMeshNode(FbxMesh* mesh, Geomet
 		FbxSkin* currSkin = reinterpret_cast<FbxSkin*>(mesh->GetDeformer(deformerIndex, FbxDeformer::eSkin));
 		if (currSkin)
 		{
-			processSkin(currSkin, geometryTransform, geometryData);
+			extractSkinClusters(currSkin, geometryTransform, skeleton, buffers);
 	
         } else {
             std::cout << "Did not find weights" << std::endl;
@@ -439,15 +585,11 @@ bool FBXGeometryLoader::extractSkeletonWeightsFromMeshNode(FbxMesh* mesh, Geomet
     } else {
         std::cout << "No deformer defined" << std::endl;
     }
-
-	for (auto it = geometryData->jointWeights.begin(); it != geometryData->jointWeights.end(); it++){
-		it->normalize();
-	}
 	return true;
 }
 
 
-GeometryData* FBXGeometryLoader::extractGeometryDataFromNodeAttribute(FbxNode* node, int attributeIndex, bool& success){
+void FBXGeometryLoader::extractMeshBuffersFromNodeAttribute(FbxNode* node, int attributeIndex, MeshBuffers& buffers){
 	std::vector<std::string> textureFileNames = std::vector<std::string>();
 	std::vector<std::string> textureNames = std::vector<std::string>();
 	extractTextureNamesFromNode(node, textureFileNames);
@@ -457,142 +599,268 @@ GeometryData* FBXGeometryLoader::extractGeometryDataFromNodeAttribute(FbxNode* n
 		textureNames.push_back(name);
 	}
 
+	// the polygons are triangulated during the conversion of the buffers
 	FbxMesh* mesh = (FbxMesh*)node->GetNodeAttributeByIndex(attributeIndex);
-	if (!mesh->IsTriangleMesh()){
-		mesh = (FbxMesh*)geometryConverter->Triangulate((FbxNodeAttribute*)mesh, true);
-	}
-	GeometryData* geometryData = NULL;
 	if (textureNames.size()> 0){
-		geometryData = createGeometryDataFromMesh(mesh, success);
-		geometryData->textureName = textureNames[0];
-        geometryData->texturePath = textureFileNames[0];
-		//geometryData->flipYandZ();
-		//geometryData->flipUVCoords();
-		//geometryData->scale(0.1);
-		
-	}
-	else{
-		geometryData = createColoredGeometryDataFromMesh(mesh, success);
+		buffers.textured = true;
+		buffers.textureName = textureNames[0];
+		buffers.texturePath = textureFileNames[0];
 	}
-
-	return geometryData;
+	extractMeshBuffersFromMesh(mesh, buffers);
 }
 
 
 
-void FBXGeometryLoader::extractSkeletonFromNode(FbxNode* node, GeometryDataList* geometryDataList, int level) {
-	if (!node) return;
-    bool foundSkeleton = false;
-    auto attribute = node->GetNodeAttribute();
-    if (attribute){
-        int attributeCount = node->GetNodeAttributeCount();
-        std::string name = node->GetName();
-        for (int i = 0; i < attributeCount; i++) {
-            FbxNodeAttribute::EType attributeType = node->GetNodeAttributeByIndex(i)->GetAttributeType();
-         
-            bool isCustomRoot = name.find("FK_back1_jnt") != std::string::npos;
-            bool isRoot = attributeType == FbxNodeAttribute::EType::eSkeleton || isCustomRoot;
-            if (geometryDataList->skeleton == NULL && isRoot) { // &&  node->GetChildCount() > 0 && level > 0
-
-                //http://stackoverflow.com/questions/13566608/loading-skinning-information-from-fbx
-                geometryDataList->skeleton = new Skeleton();
-                extractSkeletonDataNodeHierarchyRecursively(node, geometryDataList->skeleton, std::string(""), 0);
-                geometryDataList->skeleton->root = name;
-            }
-        }
-    }
-
-    if(!foundSkeleton){
-        for (int i = 0; i < node->GetChildCount(); i++) extractSkeletonFromNode(node->GetChild(i), geometryDataList, level + 1);
-    }
-   
-}
-
-void FBXGeometryLoader::extractMeshListFromNode(FbxNode* node, GeometryDataList* geometryDataList, int level){
-	if (!node) return;
-	
-      
-	bool foundGeometry = false;
-	GeometryData * geometry = NULL;
-	if (node->GetNodeAttribute() != NULL){
-
-        //check for mesh
-		int attributeCount = node->GetNodeAttributeCount();
-        int meshAttributeIndex = -1;
-		for (int i = 0; i < attributeCount; i++){
-			FbxNodeAttribute::EType lAttributeType = node->GetNodeAttributeByIndex(i)->GetAttributeType();
-            if (lAttributeType == FbxNodeAttribute::eMesh){
-                meshAttributeIndex = i;
-                std::cout << "found mesh" << std::endl;
-                break;
-                    
-            }
+void FBXGeometryLoader::convertMeshBuffers(std::vector<MeshBuffers*>& meshBuffersList, GeometryDataList* geometryDataList){
+	size_t offset = geometryDataList->meshList.size();
+	geometryDataList->meshList.resize(offset + meshBuffersList.size(), NULL);
+	parallelFor(meshBuffersList.size(), options.numThreads, [&](int i){
+		bool success = false;
+		GeometryData* geometry = createGeometryDataFromBuffers(*meshBuffersList[i], options, success);
+		geometry->skeleton = geometryDataList->skeleton;
+		if (geometry->skeleton != NULL) {
+			assignJointWeightsFromBuffers(*meshBuffersList[i], geometry);
 		}
-
-        //extract data
-		if (meshAttributeIndex != -1){
-            geometry = extractGeometryDataFromNodeAttribute(node, meshAttributeIndex, foundGeometry);
-            geometry->skeleton = geometryDataList->skeleton;
-            //  Log::write((std::string)"extract weights from mesh in attribute " + node->GetName());
-            if (geometry->skeleton != NULL) {
-                FbxMesh* mesh = (FbxMesh*)node->GetNodeAttributeByIndex(meshAttributeIndex);
-                extractSkeletonWeightsFromMeshNode(mesh, geometry);
-            }
-            geometryDataList->meshList.push_back(geometry);
+		if (options.lodRatios.size() > 0) {
+			generateLods(geometry, options.lodRatios);
 		}
-	}
-
-	for (int i = 0; i < node->GetChildCount(); i++)
-	{
-		extractMeshListFromNode(node->GetChild(i), geometryDataList, level+1);
-	}
+		if (options.optimizeVertexOrder) {
+			optimizeMesh(geometry);
+		}
+		if (options.quantizeVertices) {
+			geometry->quantized = new QuantizedMesh();
+			quantizeMesh(geometry, geometry->quantized);
+			geometry->releaseVertexBuffers();
+		}
+		geometryDataList->meshList[offset + i] = geometry;
+		delete meshBuffersList[i];
+		meshBuffersList[i] = NULL;
+	});
+	meshBuffersList.clear();
 }
 
 
-bool FBXGeometryLoader::loadGeometryDataFromFile(const char* path, GeometryDataList* geometryDataList){
+bool FBXGeometryLoader::openFile(const char* path, const LoadOptions& options){
+	this->options = options;
 	// Prepare the FBX SDK.
-	lSdkManager = FbxManager::Create();
-	if (!lSdkManager){
-		std::cout << "Unable to create FBX Manager" << std::endl;
+	if (!initializeSdk())
 		return false;
-	}
-	//Create an IOSettings object. This object holds all import/export settings.
-	FbxIOSettings* ios = FbxIOSettings::Create(lSdkManager, IOSROOT);
-	lSdkManager->SetIOSettings(ios);
+	releaseScene();
 	fbxScene = FbxScene::Create(lSdkManager, "My Scene");
 
 	FbxImporter* Importer = FbxImporter::Create(lSdkManager, "");
 	int lFileFormat = -1;
-	Importer = FbxImporter::Create(lSdkManager, "");
 	if (!lSdkManager->GetIOPluginRegistry()->DetectReaderFileFormat(path, lFileFormat))
 	{
 		// Unrecognizable file format. Try to fall back to FbxImporter::eFBX_BINARY
 		lFileFormat = lSdkManager->GetIOPluginRegistry()->FindReaderIDByDescription("FBX binary (*.fbx)");
 	}
 
-	if (!Importer->Initialize(path, lFileFormat)) {
+	configureImportSettings();
+	bool imported = Importer->Initialize(path, lFileFormat, lSdkManager->GetIOSettings());
+	if (!imported) {
 		std::cout << "Unable to initialize FBX Importer using file " << path << std::endl;
+	}
+	else if (!(imported = Importer->Import(fbxScene))){
+		std::cout << "Unable to create scene from importer" << std::endl;
+	}
+	Importer->Destroy();
+	if (!imported){
+		releaseScene();
 		return false;
 	}
+	buildSceneNodeTable();
+	return true;
+}
 
-	if (!Importer->Import(fbxScene)){
-		std::cout << "Unable to create scene from importer" << std::endl;
+void FBXGeometryLoader::closeFile(){
+	releaseScene();
+}
+
+void FBXGeometryLoader::getTakeNames(std::vector<std::string>& takeNames){
+	if (fbxScene == NULL)
+		return;
+	for (int animIdx = 0; animIdx < fbxScene->GetSrcObjectCount<FbxAnimStack>(); animIdx++){
+		takeNames.push_back(fbxScene->GetSrcObject<FbxAnimStack>(animIdx)->GetName());
+	}
+}
+
+FbxAnimStack* FBXGeometryLoader::findTake(const std::string& takeName){
+	if (fbxScene == NULL)
+		return NULL;
+	for (int animIdx = 0; animIdx < fbxScene->GetSrcObjectCount<FbxAnimStack>(); animIdx++){
+		FbxAnimStack* animStack = fbxScene->GetSrcObject<FbxAnimStack>(animIdx);
+		if (takeName == animStack->GetName())
+			return animStack;
+	}
+	return NULL;
+}
+
+bool FBXGeometryLoader::getTakeDuration(const std::string& takeName, double& duration){
+	FbxAnimStack* animStack = findTake(takeName);
+	if (animStack == NULL)
+		return false;
+	FbxTakeInfo* takeInfo = fbxScene->GetTakeInfo(animStack->GetName());
+	if (takeInfo == NULL)
+		return false;
+	duration = takeInfo->mLocalTimeSpan.GetDuration().GetSecondDouble();
+	return true;
+}
+
+void FBXGeometryLoader::getMeshNames(std::vector<std::string>& meshNames){
+	for (auto it = sceneNodes.begin(); it != sceneNodes.end(); it++){
+		if (it->meshAttributeIndex != -1)
+			meshNames.push_back(it->name);
+	}
+}
+
+// the subtree of a node follows it in the table, the joints are added in table order and thereby before their children,
+// descendants are only added if their parent is a joint and they have a skeleton attribute
+void FBXGeometryLoader::extractSkeletonFromSceneNodes(int rootIndex, Skeleton* skeleton){
+	// the rotations are taken from frame 0 of the current take, without imported takes the static pose is used
+	FbxTime time = FBXSDK_TIME_INFINITE;
+	if (options.importAnimations)
+		time.SetFrame(0);
+	std::vector<bool> isJoint(sceneNodes.size(), false);
+	for (size_t i = rootIndex; i < sceneNodes.size(); i++){
+		const SceneNode& entry = sceneNodes[i];
+		if ((int)i != rootIndex){
+			// the first node after the subtree is a child of an ancestor of the root
+			if (entry.parentIndex < rootIndex)
+				break;
+			if (!isJoint[entry.parentIndex] || !entry.hasAttribute(FbxNodeAttribute::eSkeleton))
+				continue;
+		}
+		std::string parent = (int)i != rootIndex ? sceneNodes[entry.parentIndex].name : std::string();
+		skeleton->addJoint(extractJointFromNode(entry.node, skeleton, parent, time));
+		isJoint[i] = true;
+		// the first child of a node directly follows it in the table
+		bool hasChildren = i + 1 < sceneNodes.size() && sceneNodes[i + 1].parentIndex == (int)i;
+		if (!hasChildren){
+			Joint* endSite = new Joint(skeleton);
+			endSite->name = entry.name + "EndSite";
+			endSite->offset = glm::vec3();
+			endSite->rotation = glm::quat();
+			endSite->parent = entry.name;
+			endSite->children = std::vector<Joint*>();
+			skeleton->addEndSite(endSite);
+		}
+	}
+}
+
+// the skeleton is extracted from the first skeleton node of the scene in depth first order
+void FBXGeometryLoader::extractSkeleton(GeometryDataList* geometryDataList){
+	if (geometryDataList->skeleton != NULL)
+		return;
+	for (auto it = sceneNodes.begin(); it != sceneNodes.end(); it++){
+		bool isCustomRoot = it->attributeTypes != 0 && it->name.find("FK_back1_jnt") != std::string::npos;
+		if (it->hasAttribute(FbxNodeAttribute::eSkeleton) || isCustomRoot){
+			//http://stackoverflow.com/questions/13566608/loading-skinning-information-from-fbx
+			geometryDataList->skeleton = new Skeleton();
+			extractSkeletonFromSceneNodes(it - sceneNodes.begin(), geometryDataList->skeleton);
+			geometryDataList->skeleton->root = it->name;
+			geometryDataList->skeleton->updateCacheFromOffset();
+			return;
+		}
+	}
+}
+
+void FBXGeometryLoader::extractMeshes(GeometryDataList* geometryDataList){
+	//copy data out of the SDK, the conversion happens later on worker threads
+	std::vector<MeshBuffers*> meshBuffersList;
+	for (auto it = sceneNodes.begin(); it != sceneNodes.end(); it++){
+		if (it->meshAttributeIndex == -1)
+			continue;
+		std::cout << "found mesh" << std::endl;
+		MeshBuffers* buffers = new MeshBuffers();
+		FbxMesh* mesh = (FbxMesh*)it->node->GetNodeAttributeByIndex(it->meshAttributeIndex);
+		extractMeshBuffersFromNodeAttribute(it->node, it->meshAttributeIndex, *buffers);
+		if (geometryDataList->skeleton != NULL) {
+			extractSkinBuffersFromMesh(mesh, geometryDataList->skeleton, *buffers);
+		}
+		meshBuffersList.push_back(buffers);
+	}
+	convertMeshBuffers(meshBuffersList, geometryDataList);
+}
+
+bool FBXGeometryLoader::extractTake(const std::string& takeName, double startTime, double endTime, const std::vector<std::string>& nodeNames, Skeleton* skeleton, JointFramesMap& animation){
+	FbxAnimStack* animStack = findTake(takeName);
+	if (animStack == NULL){
+		std::cout << "Unable to find take " << takeName << std::endl;
 		return false;
 	}
+	FbxTakeInfo* takeInfo = fbxScene->GetTakeInfo(animStack->GetName());
+	if (takeInfo == NULL)
+		return false;
+	fbxScene->SetCurrentAnimationStack(animStack);
+	FbxTime start = takeInfo->mLocalTimeSpan.GetStart();
+	FbxTime end = takeInfo->mLocalTimeSpan.GetStop();
+	clampToWindow(startTime, endTime, start, end);
+	double sampleRate = getSampleRate();
+	animation = JointFramesMap();
+	animation.frameTime = 1.0 / sampleRate;
+
+	// only the requested nodes are sampled, by default all nodes that are animated in one of the layers
+	std::unordered_set<std::string> requestedNames(nodeNames.begin(), nodeNames.end());
+	std::vector<bool> selected(sceneNodes.size(), false);
+	if (requestedNames.size() > 0){
+		for (size_t i = 0; i < sceneNodes.size(); i++)
+			selected[i] = requestedNames.find(sceneNodes[i].name) != requestedNames.end();
+	}
+	else{
+		for (int layerIdx = 0; layerIdx < animStack->GetMemberCount<FbxAnimLayer>(); layerIdx++){
+			const std::vector<int>& nodeIndices = getAnimatedNodeIndices(animStack->GetMember<FbxAnimLayer>(layerIdx));
+			for (auto it = nodeIndices.begin(); it != nodeIndices.end(); it++)
+				selected[*it] = true;
+		}
+	}
+	std::vector<FbxNode*> animatedNodes;
+	std::unordered_set<std::string> trackNames;
+	for (size_t i = 0; i < sceneNodes.size(); i++){
+		const std::string& nodeName = sceneNodes[i].name;
+		if (!selected[i] || trackNames.find(nodeName) != trackNames.end())
+			continue;
+		int jointIndex = skeleton != NULL ? skeleton->getJointIndex(nodeName) : -1;
+		animation.addTrack(nodeName, jointIndex);
+		trackNames.insert(nodeName);
+		animatedNodes.push_back(sceneNodes[i].node);
+	}
+	animation.resizeFrames(getNumFrames(start, end, sampleRate));
+	sampleAnimatedNodes(animatedNodes, animation, start);
+	return true;
+}
+
+bool FBXGeometryLoader::loadGeometryDataFromFile(const char* path, GeometryDataList* geometryDataList, const LoadOptions& options){
+	this->options = options;
+	std::string cachePath;
+	if (options.cacheDirectory.size() > 0){
+		cachePath = getGeometryDataCachePath(path, options);
+		if (cachePath.size() > 0 && readGeometryDataCache(cachePath.c_str(), geometryDataList)){
+			return hasImportedData(geometryDataList, options);
+		}
+	}
+	if (!openFile(path, options))
+		return false;
 
-	// Convert scene to OpenGL
-	geometryConverter = new FbxGeometryConverter(lSdkManager);
 	//Parse the scene node hiearachy to extract meshes and skeletons
-	FbxNode* root = fbxScene->GetRootNode();
-    extractSkeletonFromNode(root, geometryDataList, 0);
-    std::cout << "loaded skeleton" <<geometryDataList->skeleton->joints.size() << std::endl;
-    extractMeshListFromNode(root, geometryDataList, 0);
-	std::cout << "loaded mesh list" << geometryDataList->meshList.size() << std::endl;
-    extractAnimations(geometryDataList);
-	std::cout << "loaded animations" << geometryDataList->animations.size() << std::endl;
-	// Destroy all objects created by the FBX SDK.
-	if (lSdkManager) lSdkManager->Destroy();
-	return geometryDataList->meshList.size()>0;
+	if (options.importSkeleton){
+		extractSkeleton(geometryDataList);
+		if (geometryDataList->skeleton != NULL)
+			std::cout << "loaded skeleton" <<geometryDataList->skeleton->joints.size() << std::endl;
+	}
+	if (options.importMeshes){
+		extractMeshes(geometryDataList);
+		std::cout << "loaded mesh list" << geometryDataList->meshList.size() << std::endl;
+	}
+	if (options.importAnimations){
+		extractAnimations(geometryDataList);
+		std::cout << "loaded animations" << geometryDataList->animations.size() << std::endl;
+	}
+	releaseScene();
+	if (cachePath.size() > 0){
+		writeGeometryDataCache(cachePath.c_str(), geometryDataList);
+	}
+	return hasImportedData(geometryDataList, options);
 }
 
 
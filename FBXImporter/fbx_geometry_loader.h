@@ -25,26 +25,61 @@
 #define FBX_GEOMETRY_LOADER_H_
 #include <fbxsdk.h>
 #include <geometry_data.h>
+#include <load_options.h>
+#include <mesh_buffers.h>
 class Skeleton;
+
+// entry of the flat scene node table that is built once per imported scene and read by all extraction phases
+struct SceneNode{
+	fbxsdk::FbxNode* node;
+	std::string name;
+	int parentIndex; // -1 for the root node
+	unsigned int attributeTypes; // bit (1 << FbxNodeAttribute::EType) is set for each attribute of the node
+	int meshAttributeIndex; // index of the first mesh attribute, -1 if the node has none
+	bool hasAttribute(fbxsdk::FbxNodeAttribute::EType type) const{
+		return (attributeTypes & (1u << type)) != 0;
+	}
+};
+
 class FBXGeometryLoader{
 	public:
 		FBXGeometryLoader();
 		~FBXGeometryLoader();
-		bool loadGeometryDataFromFile(const char* path, GeometryDataList* geometryDataList);
+		bool loadGeometryDataFromFile(const char* path, GeometryDataList* geometryDataList, const LoadOptions& options = LoadOptions());
+		// imports a scene and keeps it open until closeFile, so that its content can be listed and extracted on demand
+		bool openFile(const char* path, const LoadOptions& options = LoadOptions());
+		void closeFile();
+		void getTakeNames(std::vector<std::string>& takeNames);
+		bool getTakeDuration(const std::string& takeName, double& duration);
+		void getMeshNames(std::vector<std::string>& meshNames);
+		void extractSkeleton(GeometryDataList* geometryDataList);
+		void extractMeshes(GeometryDataList* geometryDataList);
+		// samples the window [startTime, endTime) in seconds relative to the take start, a negative endTime samples until the end
+		// empty nodeNames selects all nodes that are animated in the take
+		bool extractTake(const std::string& takeName, double startTime, double endTime, const std::vector<std::string>& nodeNames, Skeleton* skeleton, JointFramesMap& animation);
 	private:
+		bool initializeSdk();
+		void releaseScene();
+		void configureImportSettings();
+		void buildSceneNodeTable();
+		const std::vector<int>& getAnimatedNodeIndices(fbxsdk::FbxAnimLayer* animLayer);
+		void extractSkeletonFromSceneNodes(int rootIndex, Skeleton* skeleton);
 		bool extractAnimations(GeometryDataList* geometryData);
-		bool extractSkeletonWeightsFromMeshNode(FbxMesh* mesh, GeometryData* geometryData);
+		fbxsdk::FbxAnimStack* findTake(const std::string& takeName);
+		double getSampleRate();
+		void restrictToTimeRange(const std::string& takeName, fbxsdk::FbxTime& start, fbxsdk::FbxTime& end);
+		void sampleAnimatedNodes(std::vector<fbxsdk::FbxNode*>& animatedNodes, JointFramesMap& animation, fbxsdk::FbxTime start);
+		void extractSkinClusters(fbxsdk::FbxSkin* currSkin, fbxsdk::FbxAMatrix& geometryTransform, Skeleton* skeleton, MeshBuffers& buffers);
+		bool extractSkinBuffersFromMesh(FbxMesh* mesh, Skeleton* skeleton, MeshBuffers& buffers);
 		void extractTextureNamesFromNode(fbxsdk::FbxNode* pNode, std::vector<std::string>& textureFileNames);
-		GeometryData* createGeometryDataFromMesh(fbxsdk::FbxMesh* pMesh,  bool& success);
-		GeometryData* createColoredGeometryDataFromMesh(fbxsdk::FbxMesh* pMesh, bool& success);
-		GeometryData* extractGeometryDataFromNodeAttribute(fbxsdk::FbxNode* node, int attributeIndex, bool& success);
-		void extractMeshListFromNode(fbxsdk::FbxNode* node, GeometryDataList* geometryDataList, int level);
-        void extractSkeletonFromNode(fbxsdk::FbxNode* node, GeometryDataList* geometryDataList, int level);
-        UVCoord getUVCoordinate(fbxsdk::FbxMesh* pMesh, FbxGeometryElementUV* fbxLayerUV, int controlPointIndex, int iPolygon, int iPolygonVertex);
-        Normal getNormal(fbxsdk::FbxMesh* pMesh,  int controlPointIndex, int vertexCount);
+		void extractMeshBuffersFromMesh(fbxsdk::FbxMesh* pMesh, MeshBuffers& buffers);
+		void extractMeshBuffersFromNodeAttribute(fbxsdk::FbxNode* node, int attributeIndex, MeshBuffers& buffers);
+		void convertMeshBuffers(std::vector<MeshBuffers*>& meshBuffersList, GeometryDataList* geometryDataList);
 		fbxsdk::FbxManager* lSdkManager = NULL;
 		fbxsdk::FbxScene* fbxScene = NULL;
-		fbxsdk::FbxGeometryConverter* geometryConverter = NULL;
+		LoadOptions options;
+		std::vector<SceneNode> sceneNodes; // depth first order, parents before their children
+		std::map<fbxsdk::FbxAnimLayer*, std::vector<int>> animatedNodeIndices; // scene nodes animated in each layer, filled when the layer is first sampled
 
 };
 
@@ -0,0 +1,184 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "forward_kinematics.h"
+#include "parallel_for.h"
+#include <algorithm>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FK_SSE2
+#endif
+
+// frames whose transformations are computed in one pass over the joint hierarchy
+static const int FK_BLOCK_FRAMES = 16;
+// frames below which a take is not split over more threads
+static const int MIN_FRAMES_PER_THREAD = 256;
+// floats per joint and frame of the local translation and quaternion and of the global rotation matrix and translation
+static const int LOCAL_CHANNELS = 7;
+static const int GLOBAL_CHANNELS = 12;
+
+#ifdef FK_SSE2
+// consecutive frames of one channel are processed in the lanes of a register
+typedef __m128 FrameLanes;
+static const int NUM_FRAME_LANES = 4;
+static inline FrameLanes loadLanes(const float* values){ return _mm_loadu_ps(values); }
+static inline void storeLanes(float* values, FrameLanes lanes){ _mm_storeu_ps(values, lanes); }
+static inline FrameLanes setLanes(float value){ return _mm_set1_ps(value); }
+static inline FrameLanes addLanes(FrameLanes a, FrameLanes b){ return _mm_add_ps(a, b); }
+static inline FrameLanes subLanes(FrameLanes a, FrameLanes b){ return _mm_sub_ps(a, b); }
+static inline FrameLanes mulLanes(FrameLanes a, FrameLanes b){ return _mm_mul_ps(a, b); }
+#else
+typedef float FrameLanes;
+static const int NUM_FRAME_LANES = 1;
+static inline FrameLanes loadLanes(const float* values){ return *values; }
+static inline void storeLanes(float* values, FrameLanes lanes){ *values = lanes; }
+static inline FrameLanes setLanes(float value){ return value; }
+static inline FrameLanes addLanes(FrameLanes a, FrameLanes b){ return a + b; }
+static inline FrameLanes subLanes(FrameLanes a, FrameLanes b){ return a - b; }
+static inline FrameLanes mulLanes(FrameLanes a, FrameLanes b){ return a * b; }
+#endif
+
+
+// transposes the frames [firstFrame, firstFrame + FK_BLOCK_FRAMES) into channel major order, frames after the end repeat the last frame
+static void loadBlock(int numJoints, int numFrames, int firstFrame, const float* translations, const float* quaternions, float* local)
+{
+	for (int f = 0; f < FK_BLOCK_FRAMES; f++){
+		int frame = std::min(firstFrame + f, numFrames - 1);
+		const float* t = translations + (size_t)frame * numJoints * 3;
+		const float* q = quaternions + (size_t)frame * numJoints * 4;
+		for (int j = 0; j < numJoints; j++){
+			float* joint = local + j * LOCAL_CHANNELS * FK_BLOCK_FRAMES + f;
+			for (int c = 0; c < 3; c++)
+				joint[c * FK_BLOCK_FRAMES] = t[j * 3 + c];
+			for (int c = 0; c < 4; c++)
+				joint[(3 + c) * FK_BLOCK_FRAMES] = q[j * 4 + c];
+		}
+	}
+}
+
+
+// global rotation matrices in row major order and translations of a block of frames,
+// the parents are stored before their children so they are already transformed
+static void transformBlock(const int* parentIndices, int numJoints, const float* local, float* global)
+{
+	const FrameLanes one = setLanes(1.0f);
+	const FrameLanes two = setLanes(2.0f);
+	for (int j = 0; j < numJoints; j++){
+		const float* l = local + j * LOCAL_CHANNELS * FK_BLOCK_FRAMES;
+		float* g = global + j * GLOBAL_CHANNELS * FK_BLOCK_FRAMES;
+		const float* p = NULL;
+		if (parentIndices[j] >= 0)
+			p = global + parentIndices[j] * GLOBAL_CHANNELS * FK_BLOCK_FRAMES;
+		for (int f = 0; f < FK_BLOCK_FRAMES; f += NUM_FRAME_LANES){
+			FrameLanes t[3];
+			for (int c = 0; c < 3; c++)
+				t[c] = loadLanes(l + c * FK_BLOCK_FRAMES + f);
+			FrameLanes w = loadLanes(l + 3 * FK_BLOCK_FRAMES + f);
+			FrameLanes x = loadLanes(l + 4 * FK_BLOCK_FRAMES + f);
+			FrameLanes y = loadLanes(l + 5 * FK_BLOCK_FRAMES + f);
+			FrameLanes z = loadLanes(l + 6 * FK_BLOCK_FRAMES + f);
+			FrameLanes x2 = mulLanes(x, two), y2 = mulLanes(y, two), z2 = mulLanes(z, two);
+			FrameLanes xx = mulLanes(x, x2), yy = mulLanes(y, y2), zz = mulLanes(z, z2);
+			FrameLanes xy = mulLanes(x, y2), xz = mulLanes(x, z2), yz = mulLanes(y, z2);
+			FrameLanes wx = mulLanes(w, x2), wy = mulLanes(w, y2), wz = mulLanes(w, z2);
+			FrameLanes r[9];
+			r[0] = subLanes(one, addLanes(yy, zz));
+			r[1] = subLanes(xy, wz);
+			r[2] = addLanes(xz, wy);
+			r[3] = addLanes(xy, wz);
+			r[4] = subLanes(one, addLanes(xx, zz));
+			r[5] = subLanes(yz, wx);
+			r[6] = subLanes(xz, wy);
+			r[7] = addLanes(yz, wx);
+			r[8] = subLanes(one, addLanes(xx, yy));
+			if (p == NULL){
+				for (int c = 0; c < 9; c++)
+					storeLanes(g + c * FK_BLOCK_FRAMES + f, r[c]);
+				for (int c = 0; c < 3; c++)
+					storeLanes(g + (9 + c) * FK_BLOCK_FRAMES + f, t[c]);
+				continue;
+			}
+			for (int row = 0; row < 3; row++){
+				FrameLanes p0 = loadLanes(p + (row * 3) * FK_BLOCK_FRAMES + f);
+				FrameLanes p1 = loadLanes(p + (row * 3 + 1) * FK_BLOCK_FRAMES + f);
+				FrameLanes p2 = loadLanes(p + (row * 3 + 2) * FK_BLOCK_FRAMES + f);
+				for (int col = 0; col < 3; col++){
+					FrameLanes value = addLanes(addLanes(mulLanes(p0, r[col]), mulLanes(p1, r[3 + col])), mulLanes(p2, r[6 + col]));
+					storeLanes(g + (row * 3 + col) * FK_BLOCK_FRAMES + f, value);
+				}
+				FrameLanes parentT = loadLanes(p + (9 + row) * FK_BLOCK_FRAMES + f);
+				FrameLanes value = addLanes(addLanes(mulLanes(p0, t[0]), mulLanes(p1, t[1])), addLanes(mulLanes(p2, t[2]), parentT));
+				storeLanes(g + (9 + row) * FK_BLOCK_FRAMES + f, value);
+			}
+		}
+	}
+}
+
+
+static void storeBlock(int numJoints, int firstFrame, int numBlockFrames, const float* global, float* transformations, float* positions)
+{
+	for (int f = 0; f < numBlockFrames; f++){
+		size_t offset = (size_t)(firstFrame + f) * numJoints;
+		for (int j = 0; j < numJoints; j++){
+			const float* g = global + j * GLOBAL_CHANNELS * FK_BLOCK_FRAMES + f;
+			if (transformations != NULL){
+				float* m = transformations + (offset + j) * 16;
+				for (int col = 0; col < 3; col++){
+					for (int row = 0; row < 3; row++)
+						m[col * 4 + row] = g[(row * 3 + col) * FK_BLOCK_FRAMES];
+					m[col * 4 + 3] = 0.0f;
+				}
+				for (int row = 0; row < 3; row++)
+					m[12 + row] = g[(9 + row) * FK_BLOCK_FRAMES];
+				m[15] = 1.0f;
+			}
+			if (positions != NULL){
+				float* position = positions + (offset + j) * 3;
+				for (int c = 0; c < 3; c++)
+					position[c] = g[(9 + c) * FK_BLOCK_FRAMES];
+			}
+		}
+	}
+}
+
+
+void computeGlobalTransformations(const int* parentIndices, int numJoints, int numFrames, const float* translations, const float* quaternions,
+								  float* transformations, float* positions, int numThreads)
+{
+	if (numJoints <= 0 || numFrames <= 0)
+		return;
+	int numBlocks = (numFrames + FK_BLOCK_FRAMES - 1) / FK_BLOCK_FRAMES;
+	numThreads = getNumWorkerThreads(numThreads, (numFrames + MIN_FRAMES_PER_THREAD - 1) / MIN_FRAMES_PER_THREAD);
+	size_t localSize = (size_t)numJoints * LOCAL_CHANNELS * FK_BLOCK_FRAMES;
+	size_t globalSize = (size_t)numJoints * GLOBAL_CHANNELS * FK_BLOCK_FRAMES;
+	std::vector<std::vector<float> > buffers(numThreads, std::vector<float>(localSize + globalSize));
+	parallelForWorkers(numBlocks, numThreads, [&](int block, int worker){
+		float* local = buffers[worker].data();
+		float* global = local + localSize;
+		int firstFrame = block * FK_BLOCK_FRAMES;
+		loadBlock(numJoints, numFrames, firstFrame, translations, quaternions, local);
+		transformBlock(parentIndices, numJoints, local, global);
+		storeBlock(numJoints, firstFrame, std::min(FK_BLOCK_FRAMES, numFrames - firstFrame), global, transformations, positions);
+	});
+}
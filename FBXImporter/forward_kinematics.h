@@ -0,0 +1,34 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef FORWARD_KINEMATICS_H_
+#define FORWARD_KINEMATICS_H_
+
+// computes the global transformations of all frames of an animation of joints in topological order,
+// translations are (frames, joints, 3) and wxyz quaternions (frames, joints, 4) relative to the parent joint.
+// transformations receives (frames, joints) column major 4x4 matrices and positions (frames, joints, 3) floats,
+// either of them may be NULL
+void computeGlobalTransformations(const int* parentIndices, int numJoints, int numFrames, const float* translations, const float* quaternions,
+								  float* transformations, float* positions, int numThreads = 0);
+
+#endif //FORWARD_KINEMATICS_H_
\ No newline at end of file
@@ -22,18 +22,28 @@
 * USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include "geometry_data.h"
+#include <algorithm>
 
 GeometryData::GeometryData(){
 	vertices = std::vector<Vertex>();
 	colors = std::vector<Color>();
 	normals = std::vector<Normal>();
 	uvs = std::vector<UVCoord>();
-	originalIndexVertexMapping = std::map<int, std::vector<int>>();
+	vertexControlPoints = std::vector<int>();
+	originalIndexVertexMapping = ControlPointVertexMapping();
 	textureName = "";
     skeleton = NULL;
 	indices = std::vector<unsigned short>();
+	indices32 = std::vector<unsigned int>();
+	indexSize = 2;
 	shaderName = "color";
-	
+	originalCacheStatistics = VertexCacheStatistics();
+	optimizedCacheStatistics = VertexCacheStatistics();
+	quantized = NULL;
+}
+
+GeometryData::~GeometryData(){
+	delete quantized;
 }
 
 
@@ -51,6 +61,80 @@ bool GeometryData::hasJointWeightData(){
 	return jointWeights.size() > 0 && skeleton != NULL;
 }
 
+void GeometryData::buildControlPointVertexMapping(int numControlPoints){
+	std::vector<int>& offsets = originalIndexVertexMapping.offsets;
+	std::vector<int>& vertexIndices = originalIndexVertexMapping.vertexIndices;
+	offsets.assign(numControlPoints + 1, 0);
+	vertexIndices.resize(vertexControlPoints.size());
+	for (size_t i = 0; i < vertexControlPoints.size(); i++){
+		offsets[vertexControlPoints[i] + 1]++;
+	}
+	for (int i = 0; i < numControlPoints; i++){
+		offsets[i + 1] += offsets[i];
+	}
+	std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < vertexControlPoints.size(); i++){
+		vertexIndices[cursor[vertexControlPoints[i]]++] = i;
+	}
+}
+
+void GeometryData::addIndex(unsigned int index){
+	if (indexSize == 2){
+		if (index <= 0xFFFF){
+			indices.push_back(index);
+			return;
+		}
+		// switch the mesh to 32 bit indices
+		indices32.reserve(indices.capacity());
+		indices32.assign(indices.begin(), indices.end());
+		indices = std::vector<unsigned short>();
+		indexSize = 4;
+	}
+	indices32.push_back(index);
+}
+
+void GeometryData::setIndices(const std::vector<unsigned int>& newIndices){
+	unsigned int maxIndex = 0;
+	for (size_t i = 0; i < newIndices.size(); i++){
+		maxIndex = std::max(maxIndex, newIndices[i]);
+	}
+	if (maxIndex <= 0xFFFF){
+		indices.assign(newIndices.begin(), newIndices.end());
+		indices32 = std::vector<unsigned int>();
+		indexSize = 2;
+	}
+	else{
+		indices32 = newIndices;
+		indices = std::vector<unsigned short>();
+		indexSize = 4;
+	}
+}
+
+// frees the buffers that are replaced by the quantized mesh
+void GeometryData::releaseVertexBuffers(){
+	vertices = std::vector<Vertex>();
+	normals = std::vector<Normal>();
+	uvs = std::vector<UVCoord>();
+	extraUVSets = std::vector<std::vector<UVCoord>>();
+	tangents = std::vector<Normal>();
+	colors = std::vector<Color>();
+	jointWeights = std::vector<VertexJointData>();
+	indices = std::vector<unsigned short>();
+	indices32 = std::vector<unsigned int>();
+}
+
+unsigned int GeometryData::getIndex(size_t i){
+	if (indexSize == 4)
+		return indices32[i];
+	return indices[i];
+}
+
+size_t GeometryData::getNumIndices(){
+	if (indexSize == 4)
+		return indices32.size();
+	return indices.size();
+}
+
 void GeometryData::scale(float factor){
 	for (int i = 0; i < vertices.size(); i++){
 		vertices[i] *= factor;
@@ -70,12 +154,85 @@ void GeometryData::flipUVCoords(){
 	for (int i = 0; i < uvs.size(); i++){
 		uvs[i].flip();
 	}
+	for (size_t i = 0; i < extraUVSets.size(); i++){
+		for (size_t j = 0; j < extraUVSets[i].size(); j++)
+			extraUVSets[i][j].flip();
+	}
 }
 int GeometryData::getNumAnimations() {
     return animations.size();
 }
 
+template<typename T>
+static size_t getVectorBytes(const std::vector<T>& values){
+	return values.capacity() * sizeof(T);
+}
+
+static size_t getAnimationBytes(std::map<std::string, JointFramesMap>& animations){
+	size_t numBytes = 0;
+	for (auto it = animations.begin(); it != animations.end(); it++){
+		numBytes += sizeof(JointFramesMap) + it->first.capacity();
+		JointFramesMap& animation = it->second;
+		numBytes += getVectorBytes(animation.localTranslations) + getVectorBytes(animation.localQuaternions);
+		numBytes += getVectorBytes(animation.jointNames) + getVectorBytes(animation.jointIndices) + getVectorBytes(animation.trackIndices);
+		for (size_t j = 0; j < animation.jointNames.size(); j++)
+			numBytes += animation.jointNames[j].capacity();
+		for (auto curveIt = it->second.curves.begin(); curveIt != it->second.curves.end(); curveIt++){
+			numBytes += sizeof(JointCurves) + curveIt->first.capacity();
+			for (int c = 0; c < 6; c++)
+				numBytes += getVectorBytes(curveIt->second.channels[c]);
+		}
+	}
+	return numBytes;
+}
+
+size_t GeometryData::getNumBytes(){
+	size_t numBytes = sizeof(GeometryData);
+	numBytes += getVectorBytes(vertices) + getVectorBytes(normals) + getVectorBytes(colors) + getVectorBytes(uvs);
+	numBytes += getVectorBytes(tangents) + getVectorBytes(extraUVSets) + getVectorBytes(uvSetNames);
+	for (size_t i = 0; i < extraUVSets.size(); i++)
+		numBytes += getVectorBytes(extraUVSets[i]);
+	numBytes += getVectorBytes(indices) + getVectorBytes(indices32) + getVectorBytes(jointWeights);
+	numBytes += getVectorBytes(vertexControlPoints);
+	numBytes += getVectorBytes(originalIndexVertexMapping.offsets) + getVectorBytes(originalIndexVertexMapping.vertexIndices);
+	numBytes += getVectorBytes(lods);
+	for (size_t i = 0; i < lods.size(); i++)
+		numBytes += getVectorBytes(lods[i].indices);
+	if (quantized != NULL)
+		numBytes += quantized->getNumBytes();
+	numBytes += getAnimationBytes(animations);
+	return numBytes;
+}
+
 GeometryDataList::GeometryDataList() {
     meshList = std::vector<GeometryData*>();
     skeleton = NULL;
 }
+
+GeometryDataList::~GeometryDataList() {
+	// the meshes share the skeleton of the list
+	for (size_t i = 0; i < meshList.size(); i++){
+		delete meshList[i];
+	}
+	for (auto it = compressedAnimations.begin(); it != compressedAnimations.end(); it++){
+		delete it->second;
+	}
+	delete skeleton;
+}
+
+size_t GeometryDataList::getNumBytes() {
+	size_t numBytes = sizeof(GeometryDataList);
+	for (size_t i = 0; i < meshList.size(); i++){
+		numBytes += meshList[i]->getNumBytes();
+	}
+	if (skeleton != NULL){
+		numBytes += sizeof(Skeleton) + skeleton->joints.size() * sizeof(Joint) + getVectorBytes(skeleton->parentIndices);
+		numBytes += getVectorBytes(skeleton->localTransformations) + getVectorBytes(skeleton->globalTransformations) + getVectorBytes(skeleton->inverseBindPoses);
+	}
+	numBytes += getAnimationBytes(animations);
+	for (auto it = compressedAnimations.begin(); it != compressedAnimations.end(); it++){
+		if (it->second != NULL)
+			numBytes += it->second->getNumBytes();
+	}
+	return numBytes;
+}
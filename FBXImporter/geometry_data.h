@@ -29,18 +29,51 @@
 #include "graphic_types.h"
 #include <skeleton.h>
 #include <joint_frames.h>
+#include "animation_compression.h"
+#include "vertex_quantization.h"
+
+// vertices created from each control point in compressed sparse row layout,
+// the vertices of control point i are vertexIndices[offsets[i]] to vertexIndices[offsets[i+1]-1]
+struct ControlPointVertexMapping{
+	std::vector<int> offsets;
+	std::vector<int> vertexIndices;
+};
+
+// simplified version of a mesh as a triangle list into the vertices of the mesh
+struct MeshLod{
+	float ratio; // requested fraction of the triangles of the mesh
+	float error; // geometric error relative to the extent of the mesh
+	std::vector<unsigned int> indices;
+};
+
+// post transform cache misses of a triangle list per triangle (acmr) and per used vertex (atvr)
+struct VertexCacheStatistics{
+	float acmr;
+	float atvr;
+};
 
 class GeometryData{
 	public:
 		GeometryData();
+		~GeometryData();
 		std::vector<Vertex> vertices;
 		std::vector<Normal> normals;
 		std::vector<unsigned short> indices;
-		std::map<int, std::vector<int>> originalIndexVertexMapping;
+		std::vector<unsigned int> indices32; // used instead of indices when indexSize is 4
+		unsigned int indexSize; // bytes per index, 2 until an index does not fit into 16 bit
+		std::vector<int> vertexControlPoints; // control point index of each vertex
+		ControlPointVertexMapping originalIndexVertexMapping;
 		std::vector<Color> colors;
 		std::vector<UVCoord> uvs;
+		std::vector<std::vector<UVCoord>> extraUVSets; // uv sets after the first, one entry per vertex each
+		std::vector<std::string> uvSetNames; // names of all uv sets, the first one is stored in uvs
+		std::vector<Normal> tangents; // empty if the mesh has no tangent layer
         Skeleton* skeleton;
 		std::vector<VertexJointData> jointWeights;
+		std::vector<MeshLod> lods; // in order of decreasing ratio
+		VertexCacheStatistics originalCacheStatistics; // of the imported triangle order, set by optimizeMesh
+		VertexCacheStatistics optimizedCacheStatistics;
+		QuantizedMesh* quantized; // vertex and index buffers of meshes loaded with quantizeVertices, owned by the mesh
         std::map<std::string, JointFramesMap> animations;
         int nPolyVertices;
 		std::string textureName; //owned by texture manager
@@ -50,18 +83,28 @@ class GeometryData{
 		bool hasColor();
 		bool hasTexture();
 		bool hasJointWeightData();
+		void buildControlPointVertexMapping(int numControlPoints);
+		void addIndex(unsigned int index);
+		void releaseVertexBuffers();
+		void setIndices(const std::vector<unsigned int>& newIndices);
+		unsigned int getIndex(size_t i);
+		size_t getNumIndices();
 		void scale(float factor);
 		void flipYandZ();
 		void flipUVCoords();
         int getNumAnimations();
+		size_t getNumBytes();
 };
 
 class GeometryDataList {
     public:
         GeometryDataList();
+        ~GeometryDataList();
         std::vector<GeometryData*> meshList;
         Skeleton* skeleton;
         std::map<std::string, JointFramesMap> animations;
+        std::map<std::string, CompressedJointFramesMap*> compressedAnimations; // sampled frames of the takes loaded with compressAnimations
+        size_t getNumBytes(); // memory held by the meshes, skeleton and animations
        
        
 };
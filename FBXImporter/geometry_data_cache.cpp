@@ -0,0 +1,807 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "geometry_data_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char GEOMETRY_DATA_CACHE_MAGIC[4] = { 'F', 'B', 'X', 'C' };
+static const unsigned long long HASH_OFFSET = 14695981039346656037ULL;
+static const unsigned long long HASH_PRIME = 1099511628211ULL;
+
+
+// read only memory mapping of a whole file
+class MappedFile{
+	public:
+		MappedFile();
+		~MappedFile();
+		bool open(const char* path);
+		const char* data;
+		size_t size;
+	private:
+#ifdef _WIN32
+		HANDLE file;
+		HANDLE mapping;
+#else
+		int file;
+#endif
+};
+
+
+MappedFile::MappedFile()
+{
+	data = NULL;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	file = -1;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data != NULL) UnmapViewOfFile(data);
+	if (mapping != NULL) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+	if (data != NULL) munmap((void*)data, size);
+	if (file >= 0) close(file);
+#endif
+}
+
+
+bool MappedFile::open(const char* path)
+{
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+		return false;
+	size = (size_t)fileSize.QuadPart;
+	if (size == 0)
+		return true;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+		return false;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	return data != NULL;
+#else
+	file = ::open(path, O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0)
+		return false;
+	size = (size_t)fileStat.st_size;
+	if (size == 0)
+		return true;
+	void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (mapped == MAP_FAILED)
+		return false;
+	data = (const char*)mapped;
+	return true;
+#endif
+}
+
+
+static unsigned long getProcessId()
+{
+#ifdef _WIN32
+	return (unsigned long)GetCurrentProcessId();
+#else
+	return (unsigned long)getpid();
+#endif
+}
+
+
+// FNV-1a over 8 byte words with an additional shift to mix the high bits into the low bits
+static unsigned long long hashBytes(const char* data, size_t size, unsigned long long hash)
+{
+	size_t numWords = size / 8;
+	for (size_t i = 0; i < numWords; i++){
+		unsigned long long word;
+		memcpy(&word, data + i * 8, 8);
+		hash = (hash ^ word) * HASH_PRIME;
+		hash ^= hash >> 32;
+	}
+	for (size_t i = numWords * 8; i < size; i++){
+		hash = (hash ^ (unsigned char)data[i]) * HASH_PRIME;
+	}
+	return hash;
+}
+
+
+class CacheWriter{
+	public:
+		std::vector<char> buffer;
+		template<typename T>
+		void write(const T& value){
+			const char* bytes = (const char*)&value;
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+		}
+		template<typename T>
+		void writeVector(const std::vector<T>& values){
+			write((unsigned long long)values.size());
+			if (values.size() > 0){
+				const char* bytes = (const char*)values.data();
+				buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+			}
+		}
+		void writeString(const std::string& value){
+			write((unsigned long long)value.size());
+			buffer.insert(buffer.end(), value.begin(), value.end());
+		}
+};
+
+
+// reads from the mapped file, ok is false after the first read past the end
+class CacheReader{
+	public:
+		CacheReader(const char* data, size_t size){
+			this->data = data;
+			this->size = size;
+			pos = 0;
+			ok = true;
+		}
+		bool ok;
+		bool readBytes(void* target, size_t numBytes){
+			if (!ok || numBytes > size - pos){
+				ok = false;
+				return false;
+			}
+			if (numBytes > 0)
+				memcpy(target, data + pos, numBytes);
+			pos += numBytes;
+			return true;
+		}
+		template<typename T>
+		void read(T& value){
+			readBytes(&value, sizeof(T));
+		}
+		// reads a size and checks it against the remaining bytes before anything is allocated
+		bool readCount(size_t elementSize, size_t& count){
+			unsigned long long value = 0;
+			read(value);
+			if (!ok || value > (size - pos) / elementSize){
+				ok = false;
+				return false;
+			}
+			count = (size_t)value;
+			return true;
+		}
+		template<typename T>
+		void readVector(std::vector<T>& values){
+			size_t count;
+			if (!readCount(sizeof(T), count))
+				return;
+			values.resize(count);
+			readBytes(values.data(), count * sizeof(T));
+		}
+		void readString(std::string& value){
+			size_t count;
+			if (!readCount(1, count))
+				return;
+			value.assign(data + pos, count);
+			pos += count;
+		}
+		bool atEnd(){
+			return ok && pos == size;
+		}
+	private:
+		const char* data;
+		size_t size;
+		size_t pos;
+};
+
+
+static void writeStrings(CacheWriter& writer, const std::vector<std::string>& values)
+{
+	writer.write((unsigned long long)values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		writer.writeString(values[i]);
+}
+
+
+static void readStrings(CacheReader& reader, std::vector<std::string>& values)
+{
+	size_t count;
+	if (!reader.readCount(sizeof(unsigned long long), count))
+		return;
+	values.resize(count);
+	for (size_t i = 0; i < count && reader.ok; i++)
+		reader.readString(values[i]);
+}
+
+
+static void writeAnimations(CacheWriter& writer, std::map<std::string, JointFramesMap>& animations)
+{
+	writer.write((unsigned long long)animations.size());
+	for (auto it = animations.begin(); it != animations.end(); it++){
+		JointFramesMap& animation = it->second;
+		writer.writeString(it->first);
+		writer.write(animation.frameTime);
+		writeStrings(writer, animation.jointNames);
+		writer.writeVector(animation.jointIndices);
+		writer.write(animation.numFrames);
+		writer.writeVector(animation.localTranslations);
+		writer.writeVector(animation.localQuaternions);
+		writer.write((unsigned long long)animation.curves.size());
+		for (auto curveIt = animation.curves.begin(); curveIt != animation.curves.end(); curveIt++){
+			writer.writeString(curveIt->first);
+			for (int c = 0; c < 6; c++)
+				writer.writeVector(curveIt->second.channels[c]);
+			writer.write(curveIt->second.rotationOrder);
+		}
+	}
+}
+
+
+static void readAnimations(CacheReader& reader, std::map<std::string, JointFramesMap>& animations, Skeleton* skeleton)
+{
+	size_t numAnimations;
+	if (!reader.readCount(sizeof(unsigned long long), numAnimations))
+		return;
+	for (size_t a = 0; a < numAnimations && reader.ok; a++){
+		std::string name;
+		reader.readString(name);
+		JointFramesMap& animation = animations[name];
+		reader.read(animation.frameTime);
+		std::vector<std::string> jointNames;
+		std::vector<int> jointIndices;
+		readStrings(reader, jointNames);
+		reader.readVector(jointIndices);
+		int numJoints = skeleton != NULL ? skeleton->jointOrder.size() : 0;
+		bool validIndices = jointNames.size() == jointIndices.size();
+		for (size_t i = 0; i < jointIndices.size() && validIndices; i++)
+			validIndices = jointIndices[i] >= -1 && jointIndices[i] < numJoints;
+		if (!reader.ok || !validIndices){
+			reader.ok = false;
+			return;
+		}
+		// adding the tracks again restores the lookup by joint index
+		for (size_t i = 0; i < jointNames.size(); i++)
+			animation.addTrack(jointNames[i], jointIndices[i]);
+		reader.read(animation.numFrames);
+		reader.readVector(animation.localTranslations);
+		reader.readVector(animation.localQuaternions);
+		size_t numValues = (size_t)animation.numFrames * jointNames.size();
+		if (animation.numFrames < 0 || animation.localTranslations.size() != numValues || animation.localQuaternions.size() != numValues){
+			reader.ok = false;
+			return;
+		}
+		size_t numCurves;
+		if (!reader.readCount(sizeof(unsigned long long), numCurves))
+			return;
+		for (size_t i = 0; i < numCurves && reader.ok; i++){
+			std::string jointName;
+			reader.readString(jointName);
+			JointCurves& curves = animation.curves[jointName];
+			for (int c = 0; c < 6; c++)
+				reader.readVector(curves.channels[c]);
+			reader.read(curves.rotationOrder);
+		}
+	}
+}
+
+
+static void writeCompressedAnimation(CacheWriter& writer, CompressedJointFramesMap* compressed)
+{
+	writeStrings(writer, compressed->jointNames);
+	writer.write(compressed->numFrames);
+	writer.write(compressed->frameTime);
+	writer.write(compressed->maxTranslationError);
+	writer.write(compressed->maxRotationError);
+	writer.write((unsigned long long)compressed->tracks.size());
+	for (size_t j = 0; j < compressed->tracks.size(); j++){
+		CompressedTrack& track = compressed->tracks[j];
+		writer.writeVector(track.translationFrameDeltas);
+		writer.writeVector(track.translations);
+		writer.writeVector(track.rotationFrameDeltas);
+		writer.writeVector(track.rotations);
+	}
+}
+
+
+static void readCompressedAnimation(CacheReader& reader, CompressedJointFramesMap* compressed)
+{
+	readStrings(reader, compressed->jointNames);
+	reader.read(compressed->numFrames);
+	reader.read(compressed->frameTime);
+	reader.read(compressed->maxTranslationError);
+	reader.read(compressed->maxRotationError);
+	size_t numTracks;
+	if (!reader.readCount(sizeof(unsigned long long), numTracks))
+		return;
+	compressed->tracks.resize(numTracks);
+	for (size_t j = 0; j < numTracks && reader.ok; j++){
+		CompressedTrack& track = compressed->tracks[j];
+		reader.readVector(track.translationFrameDeltas);
+		reader.readVector(track.translations);
+		reader.readVector(track.rotationFrameDeltas);
+		reader.readVector(track.rotations);
+		// decompression relies on one more key than frame deltas
+		if (track.translations.size() != track.translationFrameDeltas.size() + 1 || track.rotations.size() != track.rotationFrameDeltas.size() + 1)
+			reader.ok = false;
+	}
+}
+
+
+static void writeQuantizedMesh(CacheWriter& writer, QuantizedMesh* quantized)
+{
+	writer.write(quantized->numVertices);
+	writer.write(quantized->positionOffset);
+	writer.write(quantized->positionScale);
+	writer.writeVector(quantized->positions);
+	writer.writeVector(quantized->normals);
+	writer.write(quantized->uvOffset);
+	writer.write(quantized->uvScale);
+	writer.writeVector(quantized->uvs);
+	writer.write((unsigned long long)quantized->extraUVSets.size());
+	for (size_t i = 0; i < quantized->extraUVSets.size(); i++){
+		writer.write(quantized->extraUVSets[i].offset);
+		writer.write(quantized->extraUVSets[i].scale);
+		writer.writeVector(quantized->extraUVSets[i].values);
+	}
+	writer.writeVector(quantized->tangents);
+	writer.writeVector(quantized->colors);
+	writer.write(quantized->jointIndexSize);
+	writer.writeVector(quantized->jointIndices);
+	writer.writeVector(quantized->jointIndices16);
+	writer.writeVector(quantized->weights);
+	writer.write(quantized->numIndices);
+	writer.writeVector(quantized->indexData);
+	writer.write(quantized->maxPositionError);
+	writer.write(quantized->maxNormalError);
+	writer.write(quantized->maxUVError);
+	writer.write(quantized->maxTangentError);
+	writer.write(quantized->maxColorError);
+	writer.write(quantized->maxWeightError);
+}
+
+
+// the decoders rely on buffers with one entry per vertex, so other sizes are rejected as corrupt
+static void readQuantizedMesh(CacheReader& reader, QuantizedMesh* quantized)
+{
+	reader.read(quantized->numVertices);
+	reader.read(quantized->positionOffset);
+	reader.read(quantized->positionScale);
+	reader.readVector(quantized->positions);
+	reader.readVector(quantized->normals);
+	reader.read(quantized->uvOffset);
+	reader.read(quantized->uvScale);
+	reader.readVector(quantized->uvs);
+	size_t numExtraUVSets = 0;
+	reader.readCount(sizeof(float) * 4 + sizeof(unsigned long long), numExtraUVSets);
+	quantized->extraUVSets.resize(numExtraUVSets);
+	for (size_t i = 0; i < quantized->extraUVSets.size() && reader.ok; i++){
+		reader.read(quantized->extraUVSets[i].offset);
+		reader.read(quantized->extraUVSets[i].scale);
+		reader.readVector(quantized->extraUVSets[i].values);
+	}
+	reader.readVector(quantized->tangents);
+	reader.readVector(quantized->colors);
+	reader.read(quantized->jointIndexSize);
+	reader.readVector(quantized->jointIndices);
+	reader.readVector(quantized->jointIndices16);
+	reader.readVector(quantized->weights);
+	reader.read(quantized->numIndices);
+	reader.readVector(quantized->indexData);
+	reader.read(quantized->maxPositionError);
+	reader.read(quantized->maxNormalError);
+	reader.read(quantized->maxUVError);
+	reader.read(quantized->maxTangentError);
+	reader.read(quantized->maxColorError);
+	reader.read(quantized->maxWeightError);
+	size_t numVertices = quantized->numVertices >= 0 ? (size_t)quantized->numVertices : 0;
+	size_t numWeights = quantized->weights.size();
+	size_t numJointIndices = quantized->jointIndexSize == 2 ? quantized->jointIndices16.size() : quantized->jointIndices.size();
+	bool valid = quantized->numVertices >= 0 && quantized->numIndices >= 0 && quantized->positions.size() == numVertices * 3;
+	valid &= quantized->normals.size() == 0 || quantized->normals.size() == numVertices * 2;
+	valid &= quantized->uvs.size() == 0 || quantized->uvs.size() == numVertices * 2;
+	for (size_t i = 0; i < quantized->extraUVSets.size(); i++)
+		valid &= quantized->extraUVSets[i].values.size() == 0 || quantized->extraUVSets[i].values.size() == numVertices * 2;
+	valid &= quantized->tangents.size() == 0 || quantized->tangents.size() == numVertices * 2;
+	valid &= quantized->colors.size() == 0 || quantized->colors.size() == numVertices * 4;
+	valid &= (numWeights == 0 || numWeights == numVertices * NUM_JOINTS_PER_VEREX) && numJointIndices == numWeights;
+	valid &= quantized->jointIndexSize == 1 || quantized->jointIndexSize == 2;
+	if (!valid)
+		reader.ok = false;
+}
+
+
+static void writeJoint(CacheWriter& writer, Joint* joint)
+{
+	writer.writeString(joint->name);
+	writer.write(joint->numChannels);
+	writer.write(joint->offset);
+	writer.write(joint->rotation);
+	writer.writeString(joint->parent);
+}
+
+
+static Joint* readJoint(CacheReader& reader, Skeleton* skeleton)
+{
+	Joint* joint = new Joint(skeleton);
+	reader.readString(joint->name);
+	reader.read(joint->numChannels);
+	reader.read(joint->offset);
+	reader.read(joint->rotation);
+	reader.readString(joint->parent);
+	// the parent has to precede the joint and names have to be unique
+	bool hasParent = joint->parent.size() == 0 || skeleton->joints.find(joint->parent) != skeleton->joints.end();
+	if (!reader.ok || !hasParent || skeleton->joints.find(joint->name) != skeleton->joints.end()){
+		delete joint;
+		reader.ok = false;
+		return NULL;
+	}
+	return joint;
+}
+
+
+// the animated joints are stored in topological order followed by the end sites, the children are linked while adding them
+static void writeSkeleton(CacheWriter& writer, Skeleton* skeleton)
+{
+	writer.writeString(skeleton->root);
+	writer.write(skeleton->frameTime);
+	writer.write((unsigned long long)skeleton->jointOrder.size());
+	for (size_t j = 0; j < skeleton->jointOrder.size(); j++){
+		writeJoint(writer, skeleton->joints[skeleton->jointOrder[j]]);
+		writer.write(skeleton->localTransformations[j]);
+		writer.write(skeleton->inverseBindPoses[j]);
+	}
+	std::vector<Joint*> endSites;
+	for (auto it = skeleton->joints.begin(); it != skeleton->joints.end(); it++){
+		if (it->second->index < 0)
+			endSites.push_back(it->second);
+	}
+	writer.write((unsigned long long)endSites.size());
+	for (size_t j = 0; j < endSites.size(); j++){
+		writeJoint(writer, endSites[j]);
+	}
+}
+
+
+static void readSkeleton(CacheReader& reader, Skeleton* skeleton)
+{
+	reader.readString(skeleton->root);
+	reader.read(skeleton->frameTime);
+	size_t numJoints;
+	if (!reader.readCount(sizeof(unsigned long long), numJoints))
+		return;
+	for (size_t j = 0; j < numJoints && reader.ok; j++){
+		Joint* joint = readJoint(reader, skeleton);
+		if (joint == NULL)
+			return;
+		int index = skeleton->addJoint(joint);
+		reader.read(skeleton->localTransformations[index]);
+		reader.read(skeleton->inverseBindPoses[index]);
+	}
+	size_t numEndSites;
+	if (!reader.readCount(sizeof(unsigned long long), numEndSites))
+		return;
+	for (size_t j = 0; j < numEndSites && reader.ok; j++){
+		Joint* joint = readJoint(reader, skeleton);
+		if (joint == NULL)
+			return;
+		skeleton->addEndSite(joint);
+	}
+	skeleton->updateCacheFromOffset();
+}
+
+
+static void writeGeometryData(CacheWriter& writer, GeometryData* geometry)
+{
+	writer.write((unsigned char)(geometry->skeleton != NULL));
+	writer.writeVector(geometry->vertices);
+	writer.writeVector(geometry->normals);
+	writer.writeVector(geometry->indices);
+	writer.writeVector(geometry->indices32);
+	writer.write(geometry->indexSize);
+	writer.writeVector(geometry->vertexControlPoints);
+	writer.writeVector(geometry->originalIndexVertexMapping.offsets);
+	writer.writeVector(geometry->originalIndexVertexMapping.vertexIndices);
+	writer.writeVector(geometry->colors);
+	writer.writeVector(geometry->uvs);
+	writer.write((unsigned long long)geometry->extraUVSets.size());
+	for (size_t i = 0; i < geometry->extraUVSets.size(); i++)
+		writer.writeVector(geometry->extraUVSets[i]);
+	writeStrings(writer, geometry->uvSetNames);
+	writer.writeVector(geometry->tangents);
+	writer.writeVector(geometry->jointWeights);
+	writer.write((unsigned long long)geometry->lods.size());
+	for (size_t i = 0; i < geometry->lods.size(); i++){
+		writer.write(geometry->lods[i].ratio);
+		writer.write(geometry->lods[i].error);
+		writer.writeVector(geometry->lods[i].indices);
+	}
+	writer.write(geometry->originalCacheStatistics);
+	writer.write(geometry->optimizedCacheStatistics);
+	writer.write((unsigned char)(geometry->quantized != NULL));
+	if (geometry->quantized != NULL)
+		writeQuantizedMesh(writer, geometry->quantized);
+	writeAnimations(writer, geometry->animations);
+	writer.write(geometry->nPolyVertices);
+	writer.writeString(geometry->textureName);
+	writer.writeString(geometry->texturePath);
+	writer.write(geometry->drawMode);
+	writer.writeString(geometry->shaderName);
+}
+
+
+static void readGeometryData(CacheReader& reader, GeometryData* geometry, Skeleton* skeleton)
+{
+	unsigned char hasSkeleton = 0;
+	reader.read(hasSkeleton);
+	geometry->skeleton = hasSkeleton ? skeleton : NULL;
+	reader.readVector(geometry->vertices);
+	reader.readVector(geometry->normals);
+	reader.readVector(geometry->indices);
+	reader.readVector(geometry->indices32);
+	reader.read(geometry->indexSize);
+	reader.readVector(geometry->vertexControlPoints);
+	reader.readVector(geometry->originalIndexVertexMapping.offsets);
+	reader.readVector(geometry->originalIndexVertexMapping.vertexIndices);
+	reader.readVector(geometry->colors);
+	reader.readVector(geometry->uvs);
+	size_t numExtraUVSets = 0;
+	reader.readCount(sizeof(unsigned long long), numExtraUVSets);
+	geometry->extraUVSets.resize(numExtraUVSets);
+	for (size_t i = 0; i < geometry->extraUVSets.size() && reader.ok; i++)
+		reader.readVector(geometry->extraUVSets[i]);
+	readStrings(reader, geometry->uvSetNames);
+	reader.readVector(geometry->tangents);
+	reader.readVector(geometry->jointWeights);
+	size_t numLods = 0;
+	reader.readCount(sizeof(unsigned long long), numLods);
+	geometry->lods.resize(numLods);
+	for (size_t i = 0; i < geometry->lods.size() && reader.ok; i++){
+		reader.read(geometry->lods[i].ratio);
+		reader.read(geometry->lods[i].error);
+		reader.readVector(geometry->lods[i].indices);
+	}
+	reader.read(geometry->originalCacheStatistics);
+	reader.read(geometry->optimizedCacheStatistics);
+	unsigned char hasQuantized = 0;
+	reader.read(hasQuantized);
+	if (hasQuantized){
+		geometry->quantized = new QuantizedMesh();
+		readQuantizedMesh(reader, geometry->quantized);
+	}
+	readAnimations(reader, geometry->animations, skeleton);
+	reader.read(geometry->nPolyVertices);
+	reader.readString(geometry->textureName);
+	reader.readString(geometry->texturePath);
+	reader.read(geometry->drawMode);
+	reader.readString(geometry->shaderName);
+}
+
+
+std::string getGeometryDataCachePath(const char* path, const LoadOptions& options)
+{
+	MappedFile file;
+	if (!file.open(path))
+		return "";
+	unsigned long long contentHash = hashBytes(file.data, file.size, HASH_OFFSET);
+	// only the options that change the extracted data are part of the key
+	CacheWriter optionsWriter;
+	optionsWriter.write(options.weldVertices);
+	optionsWriter.write(options.keepQuads);
+	optionsWriter.write(options.extractKeyframes);
+	optionsWriter.write(options.sampleRate);
+	optionsWriter.write(options.startTime);
+	optionsWriter.write(options.endTime);
+	for (auto it = options.takeTimeRanges.begin(); it != options.takeTimeRanges.end(); it++){
+		optionsWriter.writeString(it->first);
+		optionsWriter.write(it->second.first);
+		optionsWriter.write(it->second.second);
+	}
+	optionsWriter.write(options.compressAnimations);
+	optionsWriter.write(options.translationErrorBound);
+	optionsWriter.write(options.rotationErrorBound);
+	optionsWriter.write(options.importSkeleton);
+	optionsWriter.write(options.importMeshes);
+	optionsWriter.write(options.importAnimations);
+	optionsWriter.writeVector(options.lodRatios);
+	optionsWriter.write(options.optimizeVertexOrder);
+	optionsWriter.write(options.quantizeVertices);
+	unsigned long long optionsHash = hashBytes(optionsWriter.buffer.data(), optionsWriter.buffer.size(), HASH_OFFSET);
+
+	char key[40];
+	snprintf(key, sizeof(key), "%016llx%016llx", contentHash, optionsHash);
+	std::string cachePath = options.cacheDirectory;
+	if (cachePath.size() > 0 && cachePath.back() != '/' && cachePath.back() != '\\')
+		cachePath += "/";
+	return cachePath + key + ".fbxcache";
+}
+
+
+bool readGeometryDataCache(const char* cachePath, GeometryDataList* geometryDataList)
+{
+	MappedFile file;
+	if (!file.open(cachePath))
+		return false;
+	CacheReader reader(file.data, file.size);
+	char magic[4];
+	unsigned int version = 0;
+	reader.read(magic);
+	reader.read(version);
+	if (!reader.ok || memcmp(magic, GEOMETRY_DATA_CACHE_MAGIC, 4) != 0 || version != GEOMETRY_DATA_CACHE_VERSION)
+		return false;
+
+	GeometryDataList* cached = new GeometryDataList();
+	unsigned char hasSkeleton = 0;
+	reader.read(hasSkeleton);
+	if (hasSkeleton){
+		cached->skeleton = new Skeleton();
+		readSkeleton(reader, cached->skeleton);
+	}
+	size_t numMeshes = 0;
+	reader.readCount(sizeof(unsigned long long), numMeshes);
+	for (size_t i = 0; i < numMeshes && reader.ok; i++){
+		GeometryData* geometry = new GeometryData();
+		cached->meshList.push_back(geometry);
+		readGeometryData(reader, geometry, cached->skeleton);
+	}
+	readAnimations(reader, cached->animations, cached->skeleton);
+	size_t numCompressed = 0;
+	reader.readCount(sizeof(unsigned long long), numCompressed);
+	for (size_t i = 0; i < numCompressed && reader.ok; i++){
+		std::string name;
+		reader.readString(name);
+		CompressedJointFramesMap*& compressed = cached->compressedAnimations[name];
+		delete compressed;
+		compressed = new CompressedJointFramesMap();
+		readCompressedAnimation(reader, compressed);
+	}
+	if (!reader.atEnd()){
+		std::cout << "Ignoring corrupt cache file " << cachePath << std::endl;
+		delete cached;
+		return false;
+	}
+	geometryDataList->meshList.swap(cached->meshList);
+	geometryDataList->skeleton = cached->skeleton;
+	cached->skeleton = NULL;
+	geometryDataList->animations.swap(cached->animations);
+	geometryDataList->compressedAnimations.swap(cached->compressedAnimations);
+	delete cached;
+	return true;
+}
+
+
+bool writeGeometryDataCache(const char* cachePath, GeometryDataList* geometryDataList)
+{
+	CacheWriter writer;
+	writer.write(GEOMETRY_DATA_CACHE_MAGIC);
+	writer.write(GEOMETRY_DATA_CACHE_VERSION);
+	writer.write((unsigned char)(geometryDataList->skeleton != NULL));
+	if (geometryDataList->skeleton != NULL)
+		writeSkeleton(writer, geometryDataList->skeleton);
+	writer.write((unsigned long long)geometryDataList->meshList.size());
+	for (size_t i = 0; i < geometryDataList->meshList.size(); i++)
+		writeGeometryData(writer, geometryDataList->meshList[i]);
+	writeAnimations(writer, geometryDataList->animations);
+	unsigned long long numCompressed = 0;
+	for (auto it = geometryDataList->compressedAnimations.begin(); it != geometryDataList->compressedAnimations.end(); it++){
+		if (it->second != NULL)
+			numCompressed++;
+	}
+	writer.write(numCompressed);
+	for (auto it = geometryDataList->compressedAnimations.begin(); it != geometryDataList->compressedAnimations.end(); it++){
+		if (it->second == NULL)
+			continue;
+		writer.writeString(it->first);
+		writeCompressedAnimation(writer, it->second);
+	}
+
+	// write to a unique temporary file first so that concurrent loads never map a partially written cache
+	std::string tempPath = std::string(cachePath) + "." + std::to_string(getProcessId()) + "_" +
+		std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	std::ofstream stream(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!stream){
+		std::cout << "Unable to write cache file " << tempPath << std::endl;
+		return false;
+	}
+	stream.write(writer.buffer.data(), writer.buffer.size());
+	stream.close();
+	if (!stream){
+		std::cout << "Unable to write cache file " << tempPath << std::endl;
+		std::remove(tempPath.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	bool replaced = MoveFileExA(tempPath.c_str(), cachePath, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool replaced = std::rename(tempPath.c_str(), cachePath) == 0;
+#endif
+	if (!replaced){
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+std::string serializeCompressedAnimation(CompressedJointFramesMap* compressed)
+{
+	CacheWriter writer;
+	writer.write(GEOMETRY_DATA_CACHE_VERSION);
+	writeCompressedAnimation(writer, compressed);
+	return std::string(writer.buffer.begin(), writer.buffer.end());
+}
+
+
+bool deserializeCompressedAnimation(const std::string& data, CompressedJointFramesMap* compressed)
+{
+	CacheReader reader(data.data(), data.size());
+	unsigned int version = 0;
+	reader.read(version);
+	if (!reader.ok || version != GEOMETRY_DATA_CACHE_VERSION)
+		return false;
+	readCompressedAnimation(reader, compressed);
+	return reader.atEnd();
+}
+
+
+std::string serializeQuantizedMesh(QuantizedMesh* quantized)
+{
+	CacheWriter writer;
+	writer.write(GEOMETRY_DATA_CACHE_VERSION);
+	writeQuantizedMesh(writer, quantized);
+	return std::string(writer.buffer.begin(), writer.buffer.end());
+}
+
+
+bool deserializeQuantizedMesh(const std::string& data, QuantizedMesh* quantized)
+{
+	CacheReader reader(data.data(), data.size());
+	unsigned int version = 0;
+	reader.read(version);
+	if (!reader.ok || version != GEOMETRY_DATA_CACHE_VERSION)
+		return false;
+	readQuantizedMesh(reader, quantized);
+	return reader.atEnd();
+}
\ No newline at end of file
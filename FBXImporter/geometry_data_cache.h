@@ -0,0 +1,45 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef GEOMETRY_DATA_CACHE_H_
+#define GEOMETRY_DATA_CACHE_H_
+#include <string>
+#include "geometry_data.h"
+#include "load_options.h"
+
+// increase whenever the layout of the cached data or the set of hashed load options changes
+static const unsigned int GEOMETRY_DATA_CACHE_VERSION = 13;
+
+// path of the cache file in options.cacheDirectory for the content of the file at path and the load options,
+// returns an empty string if the file cannot be read
+std::string getGeometryDataCachePath(const char* path, const LoadOptions& options);
+// fills an empty geometryDataList from a memory mapped cache file, returns false if the file is missing, outdated or corrupt
+bool readGeometryDataCache(const char* cachePath, GeometryDataList* geometryDataList);
+bool writeGeometryDataCache(const char* cachePath, GeometryDataList* geometryDataList);
+// byte serialization of a compressed take in the cache layout, used to pass it between processes
+std::string serializeCompressedAnimation(CompressedJointFramesMap* compressed);
+bool deserializeCompressedAnimation(const std::string& data, CompressedJointFramesMap* compressed);
+std::string serializeQuantizedMesh(QuantizedMesh* quantized);
+bool deserializeQuantizedMesh(const std::string& data, QuantizedMesh* quantized);
+
+#endif //GEOMETRY_DATA_CACHE_H_
\ No newline at end of file
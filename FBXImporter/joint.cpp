@@ -27,9 +27,6 @@
 #include <graphic_types.h>
 
 Joint::Joint(Skeleton* skeleton){
-	offsetMatrix = glm::mat4();
-	invBindPose = glm::mat4();
-	cachedGlobalTransformationMatrix = glm::mat4();
 	children = std::vector<Joint*>();
 	index = -1;
 	numChannels = 0;
@@ -42,41 +39,31 @@ Joint::~Joint(){
 }
 
 
-void Joint::updateCacheFromOffset(glm::mat4& parentT){
-	//update cache by frame paramters in range (index, index+numChannels)
-	if (index > -1){
-		cachedGlobalTransformationMatrix = parentT *offsetMatrix;
-		skeleton->cachedTransformations[index] =  cachedGlobalTransformationMatrix;
-		for (int i = 0; i < children.size(); i++){
-			children[i]->updateCacheFromOffset(cachedGlobalTransformationMatrix);
-		}
-	}
-}
 
-
-
-void Joint::addVertexRecursively(std::vector<Vertex>* vertices, glm::mat4* parentTransform){
+void Joint::addVertexRecursively(std::vector<Vertex>* vertices, const glm::mat4* parentTransform){
+	const glm::mat4* transform = parentTransform;
+	if (index >= 0){
+		transform = &skeleton->globalTransformations[index];
+	}
 	if (parentTransform != NULL){
 		glm::vec3 lastOffset = glm::vec3((*parentTransform)[3][0],
 			(*parentTransform)[3][1],
 			(*parentTransform)[3][2]);
 		glm::vec4 nodeOffset = glm::vec4();
 		if (index >= 0){
-			nodeOffset = glm::vec4(cachedGlobalTransformationMatrix[3][0],
-				cachedGlobalTransformationMatrix[3][1],
-				cachedGlobalTransformationMatrix[3][2], 1);
+			nodeOffset = glm::vec4((*transform)[3][0],
+				(*transform)[3][1],
+				(*transform)[3][2], 1);
 		}
 		else{
-			nodeOffset = (*parentTransform) * glm::vec4(offsetMatrix[3][0],
-																		offsetMatrix[3][1],
-																		offsetMatrix[3][2],1);
+			nodeOffset = (*parentTransform) * glm::vec4(offset, 1);
 	
 		}
 		vertices->push_back(Vertex(lastOffset));
 		vertices->push_back(Vertex(nodeOffset.x, nodeOffset.y, nodeOffset.z));
 	}
 	for (int i = 0; i < children.size(); i++){
-		children[i]->addVertexRecursively(vertices, &cachedGlobalTransformationMatrix);
+		children[i]->addVertexRecursively(vertices, transform);
 	}
 
 }
\ No newline at end of file
@@ -37,18 +37,15 @@ class Joint{
 public:
 		Joint(Skeleton* skeleton);
 		~Joint();
-		void updateCacheFromOffset(glm::mat4& parentT);
-		void addVertexRecursively(std::vector<Vertex>* vertices, glm::mat4* parentTransform);
+		void addVertexRecursively(std::vector<Vertex>* vertices, const glm::mat4* parentTransform);
 		std::string name;
+		// index into the transformation arrays of the skeleton, -1 for end sites
 		int index;
 		unsigned int numChannels;
-		glm::mat4 offsetMatrix;
         glm::vec3 offset;
         glm::quat rotation;
 		std::string parent;
 		std::vector<Joint*> children;
-		glm::mat4 invBindPose;
-		glm::mat4 cachedGlobalTransformationMatrix;
 		Skeleton* skeleton;
 
 
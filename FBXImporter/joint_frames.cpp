@@ -0,0 +1,81 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "joint_frames.h"
+
+JointFramesMap::JointFramesMap(){
+	numFrames = 0;
+	frameTime = 0.0f;
+}
+
+
+int JointFramesMap::getNumTracks(){
+	return jointNames.size();
+}
+
+
+int JointFramesMap::addTrack(const std::string& name, int jointIndex){
+	int track = jointNames.size();
+	jointNames.push_back(name);
+	jointIndices.push_back(jointIndex);
+	if (jointIndex >= 0){
+		if (jointIndex >= (int)trackIndices.size())
+			trackIndices.resize(jointIndex + 1, -1);
+		trackIndices[jointIndex] = track;
+	}
+	return track;
+}
+
+
+int JointFramesMap::getTrackIndex(int jointIndex){
+	if (jointIndex < 0 || jointIndex >= (int)trackIndices.size())
+		return -1;
+	return trackIndices[jointIndex];
+}
+
+
+void JointFramesMap::resizeFrames(int numFrames){
+	this->numFrames = numFrames;
+	localTranslations.resize((size_t)numFrames * jointNames.size());
+	localQuaternions.resize((size_t)numFrames * jointNames.size());
+}
+
+
+void JointFramesMap::clearFrames(){
+	jointNames.clear();
+	jointIndices.clear();
+	trackIndices.clear();
+	numFrames = 0;
+	localTranslations = std::vector<glm::vec3>();
+	localQuaternions = std::vector<glm::quat>();
+}
+
+
+glm::vec3* JointFramesMap::getTranslations(int frame){
+	return localTranslations.data() + (size_t)frame * jointNames.size();
+}
+
+
+glm::quat* JointFramesMap::getQuaternions(int frame){
+	return localQuaternions.data() + (size_t)frame * jointNames.size();
+}
\ No newline at end of file
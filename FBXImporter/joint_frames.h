@@ -26,20 +26,47 @@
 #include <glm\vec3.hpp>
 #include <glm/gtc/quaternion.hpp> 
 #include <glm/gtx/quaternion.hpp>
+#include <string>
 #include <vector>
 #include <map>
 
-struct JointFrames{
-	std::vector<glm::vec3> localTranslation;
-	std::vector<glm::vec3> localEulerAngles;
-	std::vector<std::string> channels;
-	std::vector<glm::quat> localQuaternions;
+struct CurveKey{
+	float time; // seconds relative to the start of the take
+	float value;
+	float leftDerivative;
+	float rightDerivative;
+	int interpolation; // FbxAnimCurveDef::EInterpolationType
+};
+
+// raw keys of the local transform curves of a joint that did not need to be sampled,
+// the channels are translation x, y, z and euler rotation x, y, z in degrees
+struct JointCurves{
+	std::vector<CurveKey> channels[6];
+	int rotationOrder; // EFbxRotationOrder, 0 is XYZ
 };
 
+// sampled local transformations of the animated nodes of a take, the frames of all tracks are stored frame by frame
+// in one buffer so that the transformation of a track at a frame is found by its index
 struct JointFramesMap{
-	std::map<std::string, JointFrames> frames;
+	JointFramesMap();
+	int getNumTracks();
+	// appends a track for a node, jointIndex is its index in the skeleton or -1, returns the track index
+	int addTrack(const std::string& name, int jointIndex);
+	// track of a skeleton joint or -1 if the joint is not animated
+	int getTrackIndex(int jointIndex);
+	// allocates numFrames frames of all tracks
+	void resizeFrames(int numFrames);
+	void clearFrames();
+	glm::vec3* getTranslations(int frame);
+	glm::quat* getQuaternions(int frame);
+	std::vector<std::string> jointNames;
+	std::vector<int> jointIndices;
+	std::vector<int> trackIndices;
+	int numFrames;
+	std::vector<glm::vec3> localTranslations;
+	std::vector<glm::quat> localQuaternions;
+	std::map<std::string, JointCurves> curves;
 	float frameTime;
 };
-typedef std::vector<JointFrames> OrderdJointFramesList;
 
 #endif //JOINT_FRAMES_H_
\ No newline at end of file
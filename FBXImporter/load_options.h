@@ -0,0 +1,70 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef LOAD_OPTIONS_H_
+#define LOAD_OPTIONS_H_
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct LoadOptions{
+	bool weldVertices; // merge polygon corners with equal control point, normal and uv
+	bool keepQuads; // keep the polygons of meshes that consist only of quads instead of triangulating them
+	int numThreads; // worker threads for the mesh conversion and animation sampling, 0 uses all cores
+	bool extractKeyframes; // store the curve keys of joints without pre/post rotations or constraints instead of sampling them
+	double sampleRate; // frames per second used to sample the animations, 0 uses the frame rate of the scene
+	double startTime; // start of the sampled window in seconds relative to the start of each take
+	double endTime; // end of the sampled window in seconds relative to the start of each take, negative for the end of the take
+	std::map<std::string, std::pair<double, double>> takeTimeRanges; // [start, end) window per take name, overrides startTime and endTime
+	bool compressAnimations; // store the sampled frames as key reduced tracks with quantized rotations
+	float translationErrorBound; // maximum translation error of the compressed frames in scene units
+	float rotationErrorBound; // maximum rotation error of the compressed frames in radians
+	std::string cacheDirectory; // directory of the binary cache of extracted files, empty disables the cache
+	// phases of the import, disabled phases also stop the FBX SDK from reading the data that only they need
+	bool importSkeleton; // the first skeleton hierarchy, required for the skin weights of the meshes
+	bool importMeshes; // meshes with their materials, textures, skin weights and inverse bind poses
+	bool importAnimations; // the takes of the scene
+	std::vector<float> lodRatios; // fractions of the triangles of the simplified levels generated for each mesh, empty disables them
+	bool optimizeVertexOrder; // reorder the triangles for the post transform cache and overdraw and the vertices for fetch locality
+	bool quantizeVertices; // keep the vertex and index buffers of the meshes only in compact quantized form
+	LoadOptions(){
+		weldVertices = false;
+		keepQuads = false;
+		numThreads = 0;
+		extractKeyframes = false;
+		sampleRate = 24;
+		startTime = 0;
+		endTime = -1;
+		compressAnimations = false;
+		translationErrorBound = 0.01f;
+		rotationErrorBound = 0.001f;
+		importSkeleton = true;
+		importMeshes = true;
+		importAnimations = true;
+		optimizeVertexOrder = false;
+		quantizeVertices = false;
+	}
+};
+
+#endif //LOAD_OPTIONS_H_
\ No newline at end of file
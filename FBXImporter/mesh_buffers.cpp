@@ -0,0 +1,419 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "mesh_buffers.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+static size_t hashFloat(float value){
+	value += 0.0f; // map -0 to +0 so that equal keys hash equally
+	unsigned int bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static void combineHash(size_t& h, float value){
+	h ^= hashFloat(value) + 0x9e3779b9 + (h << 6) + (h >> 2);
+}
+
+static void combineHash(size_t& h, const Vertex& value){
+	combineHash(h, value.x);
+	combineHash(h, value.y);
+	combineHash(h, value.z);
+}
+
+static void combineHash(size_t& h, const UVCoord& value){
+	combineHash(h, value.u);
+	combineHash(h, value.v);
+}
+
+static void combineHash(size_t& h, const Color& value){
+	combineHash(h, value.r);
+	combineHash(h, value.g);
+	combineHash(h, value.b);
+	combineHash(h, value.a);
+}
+
+// Polygon corners are welded if their control point and all of their attributes are equal. The keys of
+// the weld map are corner indices that are hashed and compared through the attribute columns of the buffers.
+struct WeldKeyHash{
+	const MeshBuffers* buffers;
+	WeldKeyHash(const MeshBuffers* buffers) : buffers(buffers){}
+	size_t operator()(int corner) const{
+		size_t h = std::hash<int>()(buffers->cornerControlPoints[corner]);
+		combineHash(h, buffers->cornerNormals[corner]);
+		combineHash(h, buffers->cornerUVs[corner]);
+		for (size_t i = 0; i < buffers->cornerExtraUVs.size(); i++)
+			combineHash(h, buffers->cornerExtraUVs[i][corner]);
+		if (!buffers->cornerColors.empty())
+			combineHash(h, buffers->cornerColors[corner]);
+		if (!buffers->cornerTangents.empty())
+			combineHash(h, buffers->cornerTangents[corner]);
+		return h;
+	}
+};
+
+struct WeldKeyEqual{
+	const MeshBuffers* buffers;
+	WeldKeyEqual(const MeshBuffers* buffers) : buffers(buffers){}
+	static bool equals(const Vertex& a, const Vertex& b){
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+	static bool equals(const UVCoord& a, const UVCoord& b){
+		return a.u == b.u && a.v == b.v;
+	}
+	static bool equals(const Color& a, const Color& b){
+		return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	}
+	bool operator()(int a, int b) const{
+		if (buffers->cornerControlPoints[a] != buffers->cornerControlPoints[b]
+			|| !equals(buffers->cornerNormals[a], buffers->cornerNormals[b])
+			|| !equals(buffers->cornerUVs[a], buffers->cornerUVs[b]))
+			return false;
+		for (size_t i = 0; i < buffers->cornerExtraUVs.size(); i++){
+			if (!equals(buffers->cornerExtraUVs[i][a], buffers->cornerExtraUVs[i][b]))
+				return false;
+		}
+		if (!buffers->cornerColors.empty() && !equals(buffers->cornerColors[a], buffers->cornerColors[b]))
+			return false;
+		if (!buffers->cornerTangents.empty() && !equals(buffers->cornerTangents[a], buffers->cornerTangents[b]))
+			return false;
+		return true;
+	}
+};
+
+// Splits polygons into triangles of local corner indices. Quads are split along the
+// diagonal through their reflex corner or else the shorter one, convex polygons into
+// a fan and the others by ear clipping in the plane of the polygon.
+class PolygonTriangulator{
+public:
+	std::vector<int> triangles; // 3 local corner indices per triangle in the winding of the polygon
+	void triangulate(const MeshBuffers& buffers, int cornerOffset, int polygonSize){
+		triangles.clear();
+		if (polygonSize == 3){
+			addTriangle(0, 1, 2);
+			return;
+		}
+		project(buffers, cornerOffset, polygonSize);
+		if (polygonSize == 4){
+			bool split02 = !isConvex(3, 0, 1) || !isConvex(1, 2, 3);
+			bool split13 = !isConvex(0, 1, 2) || !isConvex(2, 3, 0);
+			if (!split02 && !split13){
+				split02 = getSquaredDistance(buffers, cornerOffset, 0, 2) <= getSquaredDistance(buffers, cornerOffset, 1, 3);
+			}
+			if (split02){
+				addTriangle(0, 1, 2);
+				addTriangle(0, 2, 3);
+			}else{
+				addTriangle(1, 2, 3);
+				addTriangle(1, 3, 0);
+			}
+			return;
+		}
+		bool convex = true;
+		for (int i = 0; i < polygonSize && convex; i++){
+			convex = isConvex((i + polygonSize - 1) % polygonSize, i, (i + 1) % polygonSize);
+		}
+		if (convex){
+			for (int i = 1; i + 1 < polygonSize; i++){
+				addTriangle(0, i, i + 1);
+			}
+			return;
+		}
+		clipEars(polygonSize);
+	}
+
+private:
+	std::vector<float> u; // corners projected onto the plane of the polygon, counter clockwise
+	std::vector<float> v;
+	std::vector<int> remaining;
+
+	void addTriangle(int a, int b, int c){
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+	static const Vertex& getCorner(const MeshBuffers& buffers, int cornerOffset, int i){
+		return buffers.controlPoints[buffers.cornerControlPoints[cornerOffset + i]];
+	}
+
+	static float getSquaredDistance(const MeshBuffers& buffers, int cornerOffset, int a, int b){
+		const Vertex& p = getCorner(buffers, cornerOffset, a);
+		const Vertex& q = getCorner(buffers, cornerOffset, b);
+		float dx = p.x - q.x;
+		float dy = p.y - q.y;
+		float dz = p.z - q.z;
+		return dx*dx + dy*dy + dz*dz;
+	}
+
+	// drops the dominant axis of the Newell normal and orders the other two so that the polygon winds counter clockwise
+	void project(const MeshBuffers& buffers, int cornerOffset, int polygonSize){
+		float normal[3] = { 0, 0, 0 };
+		for (int i = 0; i < polygonSize; i++){
+			const Vertex& p = getCorner(buffers, cornerOffset, i);
+			const Vertex& q = getCorner(buffers, cornerOffset, (i + 1) % polygonSize);
+			normal[0] += (p.y - q.y) * (p.z + q.z);
+			normal[1] += (p.z - q.z) * (p.x + q.x);
+			normal[2] += (p.x - q.x) * (p.y + q.y);
+		}
+		int axis = 2;
+		if (std::abs(normal[0]) > std::abs(normal[1]) && std::abs(normal[0]) > std::abs(normal[2]))
+			axis = 0;
+		else if (std::abs(normal[1]) > std::abs(normal[2]))
+			axis = 1;
+		int uAxis = (axis + 1) % 3;
+		int vAxis = (axis + 2) % 3;
+		if (normal[axis] < 0)
+			std::swap(uAxis, vAxis);
+		u.resize(polygonSize);
+		v.resize(polygonSize);
+		for (int i = 0; i < polygonSize; i++){
+			const Vertex& p = getCorner(buffers, cornerOffset, i);
+			const float coordinates[3] = { p.x, p.y, p.z };
+			u[i] = coordinates[uAxis];
+			v[i] = coordinates[vAxis];
+		}
+	}
+
+	float getOrientation(int a, int b, int c) const{
+		return (u[b] - u[a]) * (v[c] - v[a]) - (v[b] - v[a]) * (u[c] - u[a]);
+	}
+
+	bool isConvex(int a, int b, int c) const{
+		return getOrientation(a, b, c) > 0;
+	}
+
+	bool isEar(int k) const{
+		int n = remaining.size();
+		int a = remaining[(k + n - 1) % n];
+		int b = remaining[k];
+		int c = remaining[(k + 1) % n];
+		if (!isConvex(a, b, c))
+			return false;
+		for (int i = 0; i < n; i++){
+			int p = remaining[i];
+			if (p == a || p == b || p == c)
+				continue;
+			if (getOrientation(a, b, p) >= 0 && getOrientation(b, c, p) >= 0 && getOrientation(c, a, p) >= 0)
+				return false;
+		}
+		return true;
+	}
+
+	void clipEars(int polygonSize){
+		remaining.resize(polygonSize);
+		for (int i = 0; i < polygonSize; i++){
+			remaining[i] = i;
+		}
+		while (remaining.size() > 3){
+			int n = remaining.size();
+			int ear = 0;
+			while (ear < n && !isEar(ear))
+				ear++;
+			if (ear == n)
+				ear = 1; // degenerate or self intersecting polygons continue as a fan
+			addTriangle(remaining[(ear + n - 1) % n], remaining[ear], remaining[(ear + 1) % n]);
+			remaining.erase(remaining.begin() + ear);
+		}
+		addTriangle(remaining[0], remaining[1], remaining[2]);
+	}
+};
+
+// quads are only kept if all polygons of the mesh are quads, ignoring points and lines
+static bool keepsQuads(const MeshBuffers& buffers, const LoadOptions& options){
+	if (!options.keepQuads)
+		return false;
+	bool hasQuads = false;
+	for (size_t iPolygon = 0; iPolygon < buffers.polygonSizes.size(); iPolygon++){
+		int polygonSize = buffers.polygonSizes[iPolygon];
+		if (polygonSize >= 3 && polygonSize != 4)
+			return false;
+		hasQuads |= polygonSize == 4;
+	}
+	return hasQuads;
+}
+
+// emits the indices of a polygon given the vertex of each of its corners
+static void addPolygonIndices(GeometryData* geometryData, PolygonTriangulator& triangulator, const MeshBuffers& buffers, int cornerOffset, const std::vector<int>& polygonVertices, bool quads){
+	int polygonSize = polygonVertices.size();
+	if (quads){
+		for (int i = 0; i < polygonSize; i++){
+			geometryData->addIndex(polygonVertices[i]);
+		}
+		return;
+	}
+	triangulator.triangulate(buffers, cornerOffset, polygonSize);
+	for (size_t i = 0; i < triangulator.triangles.size(); i++){
+		geometryData->addIndex(polygonVertices[triangulator.triangles[i]]);
+	}
+}
+
+static void setPolygonMode(GeometryData* geometryData, bool quads){
+	geometryData->nPolyVertices = quads ? 4 : 3;
+	geometryData->drawMode = quads ? 4 : 3;
+}
+
+GeometryData* createTexturedGeometryData(const MeshBuffers& buffers, const LoadOptions& options, bool& success){
+	GeometryData* geometryData = new GeometryData();
+	if (!buffers.hasUVs){
+		success = false;
+		return geometryData;
+	}
+	unsigned int ctrlPointCount = buffers.controlPoints.size();
+	unsigned int polygonCount = buffers.polygonSizes.size();
+	bool quads = keepsQuads(buffers, options);
+	bool hasColors = !buffers.cornerColors.empty();
+	bool hasTangents = !buffers.cornerTangents.empty();
+	int numExtraUVSets = buffers.cornerExtraUVs.size();
+	int vertexCount = 0;
+	int cornerOffset = 0;
+	PolygonTriangulator triangulator;
+	std::vector<int> polygonVertices;
+	std::unordered_map<int, int, WeldKeyHash, WeldKeyEqual> weldedVertices(0, WeldKeyHash(&buffers), WeldKeyEqual(&buffers));
+	geometryData->uvSetNames = buffers.uvSetNames;
+	geometryData->extraUVSets.resize(numExtraUVSets);
+	if (options.weldVertices){
+		weldedVertices.reserve(ctrlPointCount * 2);
+	}else{
+		size_t cornerCount = buffers.cornerControlPoints.size();
+		geometryData->vertices.reserve(cornerCount);
+		geometryData->normals.reserve(cornerCount);
+		geometryData->uvs.reserve(cornerCount);
+		geometryData->vertexControlPoints.reserve(cornerCount);
+		for (int i = 0; i < numExtraUVSets; i++)
+			geometryData->extraUVSets[i].reserve(cornerCount);
+		if (hasColors)
+			geometryData->colors.reserve(cornerCount);
+		if (hasTangents)
+			geometryData->tangents.reserve(cornerCount);
+	}
+
+	for (unsigned int iPolygon = 0; iPolygon < polygonCount; iPolygon++) {
+		int polygonSize = buffers.polygonSizes[iPolygon];
+		if (polygonSize < 3){
+			// points and lines have no area
+			cornerOffset += polygonSize;
+			continue;
+		}
+		polygonVertices.resize(polygonSize);
+		for (int iPolygonVertex = 0; iPolygonVertex < polygonSize; iPolygonVertex++) {
+			int cornerIndex = cornerOffset + iPolygonVertex;
+			int controlPointIndex = buffers.cornerControlPoints[cornerIndex];
+			if (options.weldVertices){
+				auto result = weldedVertices.emplace(cornerIndex, vertexCount);
+				if (!result.second){
+					polygonVertices[iPolygonVertex] = result.first->second;
+					continue;
+				}
+			}
+			polygonVertices[iPolygonVertex] = vertexCount;
+			geometryData->vertices.push_back(buffers.controlPoints[controlPointIndex]);
+			geometryData->normals.push_back(buffers.cornerNormals[cornerIndex]);
+			geometryData->uvs.push_back(buffers.cornerUVs[cornerIndex]);
+			for (int i = 0; i < numExtraUVSets; i++)
+				geometryData->extraUVSets[i].push_back(buffers.cornerExtraUVs[i][cornerIndex]);
+			if (hasColors)
+				geometryData->colors.push_back(buffers.cornerColors[cornerIndex]);
+			if (hasTangents)
+				geometryData->tangents.push_back(buffers.cornerTangents[cornerIndex]);
+			geometryData->vertexControlPoints.push_back(controlPointIndex);
+			vertexCount++;
+		}
+		addPolygonIndices(geometryData, triangulator, buffers, cornerOffset, polygonVertices, quads);
+		cornerOffset += polygonSize;
+	}
+	geometryData->buildControlPointVertexMapping(ctrlPointCount);
+	setPolygonMode(geometryData, quads);
+	geometryData->textureName = buffers.textureName;
+	geometryData->texturePath = buffers.texturePath;
+	success = true;
+	return geometryData;
+}
+
+GeometryData* createColoredGeometryData(const MeshBuffers& buffers, const LoadOptions& options, bool& success){
+	GeometryData* geometryData = new GeometryData();
+	geometryData->vertices = buffers.controlPoints;
+	geometryData->vertexControlPoints.resize(buffers.controlPoints.size());
+	for (size_t i = 0; i < buffers.controlPoints.size(); i++){
+		geometryData->vertexControlPoints[i] = i;
+	}
+	geometryData->buildControlPointVertexMapping(buffers.controlPoints.size());
+
+	bool quads = keepsQuads(buffers, options);
+	int cornerOffset = 0;
+	PolygonTriangulator triangulator;
+	std::vector<int> polygonVertices;
+	for (size_t iPolygon = 0; iPolygon < buffers.polygonSizes.size(); iPolygon++) {
+		int polygonSize = buffers.polygonSizes[iPolygon];
+		if (polygonSize >= 3){
+			polygonVertices.assign(buffers.cornerControlPoints.begin() + cornerOffset, buffers.cornerControlPoints.begin() + cornerOffset + polygonSize);
+			addPolygonIndices(geometryData, triangulator, buffers, cornerOffset, polygonVertices, quads);
+		}
+		cornerOffset += polygonSize;
+	}
+
+	geometryData->shaderName = "color";
+	setPolygonMode(geometryData, quads);
+	if (buffers.cornerColors.empty()){
+		geometryData->colors.assign(geometryData->vertices.size(), Color(1, 0, 0, 1));
+	}else{
+		// the vertices are the control points, so corners of the same control point share one color
+		geometryData->colors.resize(geometryData->vertices.size());
+		for (size_t i = 0; i < buffers.cornerColors.size(); i++)
+			geometryData->colors[buffers.cornerControlPoints[i]] = buffers.cornerColors[i];
+	}
+	success = true;
+	return geometryData;
+}
+
+GeometryData* createGeometryDataFromBuffers(const MeshBuffers& buffers, const LoadOptions& options, bool& success){
+	if (buffers.textured)
+		return createTexturedGeometryData(buffers, options, success);
+	return createColoredGeometryData(buffers, options, success);
+}
+
+void assignJointWeightsFromBuffers(const MeshBuffers& buffers, GeometryData* geometryData){
+	if (buffers.hasSkin){
+		// create empty joint weights
+		geometryData->jointWeights.assign(geometryData->vertices.size(), VertexJointData());
+		const std::vector<int>& offsets = geometryData->originalIndexVertexMapping.offsets;
+		const std::vector<int>& vertexIndices = geometryData->originalIndexVertexMapping.vertexIndices;
+		int numControlPoints = (int)offsets.size() - 1;
+		for (auto cluster = buffers.skinClusters.begin(); cluster != buffers.skinClusters.end(); cluster++){
+			for (size_t i = 0; i < cluster->controlPointIndices.size(); i++){
+				int controlPointIndex = cluster->controlPointIndices[i];
+				if (controlPointIndex < 0 || controlPointIndex >= numControlPoints)
+					continue;
+				for (int k = offsets[controlPointIndex]; k < offsets[controlPointIndex + 1]; k++) {
+					geometryData->jointWeights[vertexIndices[k]].addJointWeight(cluster->jointIndex, cluster->weights[i]);
+				}
+			}
+		}
+	}
+	for (auto it = geometryData->jointWeights.begin(); it != geometryData->jointWeights.end(); it++){
+		it->normalize();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef MESH_BUFFERS_H_
+#define MESH_BUFFERS_H_
+#include <string>
+#include <vector>
+#include "graphic_types.h"
+#include "load_options.h"
+#include "geometry_data.h"
+
+struct SkinClusterBuffer{
+	int jointIndex;
+	std::vector<int> controlPointIndices;
+	std::vector<double> weights;
+};
+
+// Plain copy of the mesh data read from the FBX SDK. It is filled in a serial
+// pass over the scene and converted into GeometryData on worker threads.
+struct MeshBuffers{
+	bool textured; // textured meshes get per corner vertices, the others use the control points
+	bool hasUVs;
+	std::string textureName;
+	std::string texturePath;
+	std::vector<Vertex> controlPoints;
+	std::vector<int> polygonSizes;
+	std::vector<int> cornerControlPoints; // control point index of each polygon corner
+	std::vector<Normal> cornerNormals;
+	std::vector<UVCoord> cornerUVs; // first uv set, used for texturing
+	std::vector<std::vector<UVCoord>> cornerExtraUVs; // remaining uv sets
+	std::vector<std::string> uvSetNames; // names of all uv sets
+	std::vector<Color> cornerColors; // first vertex color layer, empty if the mesh has none
+	std::vector<Normal> cornerTangents; // first tangent layer, empty if the mesh has none
+	bool hasSkin;
+	std::vector<SkinClusterBuffer> skinClusters;
+	MeshBuffers(){
+		textured = false;
+		hasUVs = false;
+		hasSkin = false;
+	}
+};
+
+GeometryData* createGeometryDataFromBuffers(const MeshBuffers& buffers, const LoadOptions& options, bool& success);
+void assignJointWeightsFromBuffers(const MeshBuffers& buffers, GeometryData* geometryData);
+
+#endif //MESH_BUFFERS_H_
\ No newline at end of file
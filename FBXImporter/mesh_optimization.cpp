@@ -0,0 +1,359 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "mesh_optimization.h"
+#include "mesh_simplification.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// scoring of the vertex cache optimization, see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+static const int FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+// valences above this share the score of the last entry of the table
+static const int MAX_SCORED_VALENCE = 32;
+// cache size of the simulation that splits the triangles into clusters for the overdraw optimization
+static const int OVERDRAW_CACHE_SIZE = 16;
+
+
+// fifo cache that stores the insertion time of each vertex, a vertex is cached if at most cacheSize vertices were inserted since
+class FifoCache{
+	public:
+		FifoCache(size_t numVertices, int cacheSize){
+			timestamps.assign(numVertices, 0);
+			this->cacheSize = cacheSize;
+			time = cacheSize + 1;
+		}
+		// returns true for a cache miss
+		bool access(unsigned int vertex){
+			if (time - timestamps[vertex] <= (unsigned int)cacheSize)
+				return false;
+			timestamps[vertex] = time++;
+			return true;
+		}
+		void clear(){
+			time += cacheSize + 1;
+		}
+	private:
+		std::vector<unsigned int> timestamps;
+		unsigned int time;
+		int cacheSize;
+};
+
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<unsigned int>& indices, size_t numVertices, int cacheSize)
+{
+	FifoCache cache(numVertices, cacheSize);
+	std::vector<unsigned char> used(numVertices, 0);
+	size_t misses = 0;
+	size_t numUsed = 0;
+	for (size_t i = 0; i < indices.size(); i++){
+		misses += cache.access(indices[i]);
+		numUsed += used[indices[i]] == 0;
+		used[indices[i]] = 1;
+	}
+	VertexCacheStatistics statistics;
+	statistics.acmr = indices.size() >= 3 ? (float)misses / (indices.size() / 3) : 0;
+	statistics.atvr = numUsed > 0 ? (float)misses / numUsed : 0;
+	return statistics;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t numVertices)
+{
+	size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0)
+		return;
+	float cacheScores[FORSYTH_CACHE_SIZE];
+	for (int i = 0; i < FORSYTH_CACHE_SIZE; i++){
+		// the vertices of the last triangle get a fixed score so that strips are not preferred over fans
+		cacheScores[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.0f - (i - 3) / (float)(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+	}
+	float valenceScores[MAX_SCORED_VALENCE + 1];
+	valenceScores[0] = 0;
+	for (int i = 1; i <= MAX_SCORED_VALENCE; i++){
+		valenceScores[i] = VALENCE_BOOST_SCALE * std::pow((float)i, -VALENCE_BOOST_POWER);
+	}
+	auto getVertexScore = [&](int cachePosition, unsigned int numLiveTriangles){
+		if (numLiveTriangles == 0)
+			return -1.0f;
+		float score = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+		return score + valenceScores[std::min(numLiveTriangles, (unsigned int)MAX_SCORED_VALENCE)];
+	};
+
+	// live triangles of each vertex, emitted triangles are swapped behind the live range
+	std::vector<unsigned int> offsets(numVertices + 1, 0);
+	std::vector<unsigned int> liveTriangles(numVertices, 0);
+	for (size_t i = 0; i < numTriangles * 3; i++){
+		liveTriangles[indices[i]]++;
+	}
+	for (size_t v = 0; v < numVertices; v++){
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+	}
+	std::vector<unsigned int> vertexTriangles(numTriangles * 3);
+	{
+		std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < numTriangles * 3; i++){
+			vertexTriangles[cursor[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+	std::vector<float> vertexScores(numVertices);
+	for (size_t v = 0; v < numVertices; v++){
+		vertexScores[v] = getVertexScore(-1, liveTriangles[v]);
+	}
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<unsigned char> emitted(numTriangles, 0);
+	for (size_t t = 0; t < numTriangles; t++){
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+
+	std::vector<unsigned int> result;
+	result.reserve(numTriangles * 3);
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+	int cacheSize = 0;
+	size_t scanCursor = 0;
+	int bestTriangle = -1;
+	while (result.size() < numTriangles * 3){
+		if (bestTriangle < 0){
+			// dead end, continue with the next triangle in input order
+			while (emitted[scanCursor])
+				scanCursor++;
+			bestTriangle = (int)scanCursor;
+		}
+		const unsigned int* triangle = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = 1;
+		result.insert(result.end(), triangle, triangle + 3);
+
+		// the vertices of the triangle move to the front of the cache
+		int newCacheSize = 0;
+		for (int k = 0; k < 3; k++){
+			unsigned int v = triangle[k];
+			newCache[newCacheSize++] = v;
+			unsigned int* first = &vertexTriangles[offsets[v]];
+			unsigned int* last = first + liveTriangles[v];
+			std::swap(*std::find(first, last, (unsigned int)bestTriangle), *(last - 1));
+			liveTriangles[v]--;
+		}
+		for (int i = 0; i < cacheSize; i++){
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCacheSize++] = v;
+		}
+		// update the scores of the cached and the evicted vertices and their remaining triangles
+		for (int i = 0; i < newCacheSize; i++){
+			unsigned int v = newCache[i];
+			float score = getVertexScore(i < FORSYTH_CACHE_SIZE ? i : -1, liveTriangles[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+			for (unsigned int e = offsets[v]; e < offsets[v] + liveTriangles[v]; e++){
+				triangleScores[vertexTriangles[e]] += delta;
+			}
+		}
+		cacheSize = std::min(newCacheSize, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheSize, cache);
+		// the next triangle is the best one that uses a cached vertex
+		bestTriangle = -1;
+		float bestScore = -1;
+		for (int i = 0; i < cacheSize; i++){
+			unsigned int v = cache[i];
+			for (unsigned int e = offsets[v]; e < offsets[v] + liveTriangles[v]; e++){
+				unsigned int t = vertexTriangles[e];
+				if (triangleScores[t] > bestScore){
+					bestScore = triangleScores[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+	}
+	indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, float threshold)
+{
+	size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0)
+		return;
+	FifoCache cache(positions.size(), OVERDRAW_CACHE_SIZE);
+	auto getMisses = [&](size_t t){
+		return (int)cache.access(indices[t * 3]) + (int)cache.access(indices[t * 3 + 1]) + (int)cache.access(indices[t * 3 + 2]);
+	};
+	// hard boundaries where the cache order starts over with three misses
+	std::vector<size_t> hardClusters;
+	for (size_t t = 0; t < numTriangles; t++){
+		if (getMisses(t) == 3 || t == 0)
+			hardClusters.push_back(t);
+	}
+	hardClusters.push_back(numTriangles);
+	// soft boundaries inside each of them where the misses of a new cluster would stay within the threshold
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++){
+		size_t start = hardClusters[c];
+		size_t end = hardClusters[c + 1];
+		cache.clear();
+		size_t clusterMisses = 0;
+		for (size_t t = start; t < end; t++){
+			clusterMisses += getMisses(t);
+		}
+		float clusterAcmr = (float)clusterMisses / (end - start);
+		clusters.push_back(start);
+		cache.clear();
+		size_t subStart = start;
+		size_t misses = 0;
+		for (size_t t = start; t + 1 < end; t++){
+			misses += getMisses(t);
+			if (misses <= threshold * clusterAcmr * (t + 1 - subStart)){
+				clusters.push_back(t + 1);
+				subStart = t + 1;
+				misses = 0;
+				cache.clear();
+			}
+		}
+	}
+	clusters.push_back(numTriangles);
+
+	// clusters that face away from the center of the mesh are drawn first
+	size_t numClusters = clusters.size() - 1;
+	std::vector<glm::vec3> centroids(numClusters, glm::vec3(0));
+	std::vector<glm::vec3> normals(numClusters, glm::vec3(0));
+	std::vector<float> areas(numClusters, 0);
+	glm::vec3 meshCentroid(0);
+	float meshArea = 0;
+	for (size_t c = 0; c < numClusters; c++){
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++){
+			const glm::vec3& p0 = positions[indices[t * 3]];
+			const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = std::sqrt(glm::dot(normal, normal));
+			centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[c] += normal;
+			areas[c] += area;
+		}
+		meshCentroid += centroids[c];
+		meshArea += areas[c];
+	}
+	if (meshArea > 0)
+		meshCentroid *= 1.0f / meshArea;
+	std::vector<float> sortKeys(numClusters, 0);
+	for (size_t c = 0; c < numClusters; c++){
+		float normalLength = std::sqrt(glm::dot(normals[c], normals[c]));
+		if (areas[c] > 0 && normalLength > 0)
+			sortKeys[c] = glm::dot(centroids[c] * (1.0f / areas[c]) - meshCentroid, normals[c] * (1.0f / normalLength));
+	}
+	std::vector<size_t> order(numClusters);
+	for (size_t c = 0; c < numClusters; c++){
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+		return sortKeys[a] > sortKeys[b];
+	});
+	std::vector<unsigned int> result;
+	result.reserve(numTriangles * 3);
+	for (size_t i = 0; i < numClusters; i++){
+		size_t c = order[i];
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	indices.swap(result);
+}
+
+template<typename T>
+static void permuteVertices(std::vector<T>& values, const std::vector<unsigned int>& remap)
+{
+	if (values.size() != remap.size())
+		return;
+	std::vector<T> permuted(values.size());
+	for (size_t i = 0; i < values.size(); i++){
+		permuted[remap[i]] = values[i];
+	}
+	values.swap(permuted);
+}
+
+void optimizeMesh(GeometryData* geometry)
+{
+	size_t numVertices = geometry->vertices.size();
+	std::vector<unsigned int> triangles;
+	getTriangleIndices(geometry, triangles);
+	geometry->originalCacheStatistics = analyzeVertexCache(triangles, numVertices);
+
+	std::vector<unsigned int> indices(geometry->getNumIndices());
+	for (size_t i = 0; i < indices.size(); i++){
+		indices[i] = geometry->getIndex(i);
+	}
+	if (geometry->nPolyVertices != 4){
+		std::vector<glm::vec3> positions(numVertices);
+		for (size_t i = 0; i < numVertices; i++){
+			positions[i] = glm::vec3(geometry->vertices[i].x, geometry->vertices[i].y, geometry->vertices[i].z);
+		}
+		indices.swap(triangles);
+		optimizeVertexCache(indices, numVertices);
+		optimizeOverdraw(indices, positions);
+		for (size_t l = 0; l < geometry->lods.size(); l++){
+			optimizeVertexCache(geometry->lods[l].indices, numVertices);
+			optimizeOverdraw(geometry->lods[l].indices, positions);
+		}
+	}
+
+	// vertices in the order of their first use, unused vertices are moved to the end
+	std::vector<unsigned int> remap(numVertices, UINT_MAX);
+	unsigned int numRemapped = 0;
+	for (size_t i = 0; i < indices.size(); i++){
+		if (remap[indices[i]] == UINT_MAX)
+			remap[indices[i]] = numRemapped++;
+	}
+	for (size_t l = 0; l < geometry->lods.size(); l++){
+		for (size_t i = 0; i < geometry->lods[l].indices.size(); i++){
+			if (remap[geometry->lods[l].indices[i]] == UINT_MAX)
+				remap[geometry->lods[l].indices[i]] = numRemapped++;
+		}
+	}
+	for (size_t v = 0; v < numVertices; v++){
+		if (remap[v] == UINT_MAX)
+			remap[v] = numRemapped++;
+	}
+	permuteVertices(geometry->vertices, remap);
+	permuteVertices(geometry->normals, remap);
+	permuteVertices(geometry->uvs, remap);
+	for (size_t i = 0; i < geometry->extraUVSets.size(); i++)
+		permuteVertices(geometry->extraUVSets[i], remap);
+	permuteVertices(geometry->tangents, remap);
+	permuteVertices(geometry->colors, remap);
+	permuteVertices(geometry->jointWeights, remap);
+	permuteVertices(geometry->vertexControlPoints, remap);
+	if (geometry->originalIndexVertexMapping.offsets.size() > 0)
+		geometry->buildControlPointVertexMapping((int)geometry->originalIndexVertexMapping.offsets.size() - 1);
+	for (size_t i = 0; i < indices.size(); i++){
+		indices[i] = remap[indices[i]];
+	}
+	geometry->setIndices(indices);
+	for (size_t l = 0; l < geometry->lods.size(); l++){
+		std::vector<unsigned int>& lodIndices = geometry->lods[l].indices;
+		for (size_t i = 0; i < lodIndices.size(); i++){
+			lodIndices[i] = remap[lodIndices[i]];
+		}
+	}
+	getTriangleIndices(geometry, triangles);
+	geometry->optimizedCacheStatistics = analyzeVertexCache(triangles, numVertices);
+}
\ No newline at end of file
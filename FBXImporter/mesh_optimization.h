@@ -0,0 +1,41 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef MESH_OPTIMIZATION_H_
+#define MESH_OPTIMIZATION_H_
+#include <vector>
+#include <glm\vec3.hpp>
+#include "geometry_data.h"
+
+// simulates a fifo post transform cache of cacheSize vertices for a triangle list
+VertexCacheStatistics analyzeVertexCache(const std::vector<unsigned int>& indices, size_t numVertices, int cacheSize = 16);
+// reorders the triangles for reuse in a post transform cache with the linear speed algorithm of Tom Forsyth
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t numVertices);
+// splits the cache optimized triangles into clusters whose cache misses stay within threshold of the unsplit order and
+// sorts the clusters so that the ones facing away from the center are drawn first, which occlude the others
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f);
+// triangle order, overdraw and vertex fetch order of the mesh and its lods, the vertex buffers are sorted by the first use
+// in the triangles of the mesh, quad meshes only get the vertex fetch order
+void optimizeMesh(GeometryData* geometry);
+
+#endif //MESH_OPTIMIZATION_H_
\ No newline at end of file
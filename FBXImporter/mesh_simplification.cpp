@@ -0,0 +1,485 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "mesh_simplification.h"
+#include "geometry_data.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+enum VertexKind{
+	VERTEX_MANIFOLD, // single vertex of its position without open edges
+	VERTEX_BORDER, // single vertex of its position with one open edge in each direction
+	VERTEX_SEAM, // two vertices of the same position whose open edges continue on the other side
+	VERTEX_LOCKED
+};
+
+// allowed collapses from the kind of the row onto the kind of the column
+static const bool CAN_COLLAPSE[4][4] = {
+	{ true, true, true, true },
+	{ false, true, false, true },
+	{ false, true, true, true },
+	{ false, false, false, false }
+};
+// weight of the planes through border and seam edges relative to the triangle planes
+static const double BOUNDARY_WEIGHT = 10.0;
+// collapses that turn a triangle normal by more than about 75 degrees are rejected
+static const float MIN_NORMAL_COS = 0.25f;
+
+struct EdgeCollapse{
+	unsigned int v0, v1; // v0 is replaced by v1
+	unsigned int s0, s1; // second side of a seam collapse, equal to v0 and v1 otherwise
+	float cost;
+};
+
+static void addPlane(Quadric& q, double a, double b, double c, double d, double weight)
+{
+	q.a2 += weight * a * a;
+	q.b2 += weight * b * b;
+	q.c2 += weight * c * c;
+	q.ab += weight * a * b;
+	q.ac += weight * a * c;
+	q.bc += weight * b * c;
+	q.ad += weight * a * d;
+	q.bd += weight * b * d;
+	q.cd += weight * c * d;
+	q.d2 += weight * d * d;
+	q.weight += weight;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other)
+{
+	q.a2 += other.a2;
+	q.b2 += other.b2;
+	q.c2 += other.c2;
+	q.ab += other.ab;
+	q.ac += other.ac;
+	q.bc += other.bc;
+	q.ad += other.ad;
+	q.bd += other.bd;
+	q.cd += other.cd;
+	q.d2 += other.d2;
+	q.weight += other.weight;
+}
+
+// mean squared distance of p to the planes of the quadric
+static double evaluateQuadric(const Quadric& q, const glm::vec3& p)
+{
+	double x = p.x, y = p.y, z = p.z;
+	double r = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z + 2 * (q.ab * x * y + q.ac * x * z + q.bc * y * z)
+		+ 2 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+	return q.weight > 0 ? std::fabs(r) / q.weight : 0;
+}
+
+// true if the buffer has no entry per vertex or the entries of a and b are equal
+template<typename T>
+static bool hasEqualEntries(const std::vector<T>& values, size_t numVertices, unsigned int a, unsigned int b)
+{
+	return values.size() != numVertices || memcmp(&values[a], &values[b], sizeof(T)) == 0;
+}
+
+static bool hasEqualAttributes(GeometryData* geometry, unsigned int a, unsigned int b)
+{
+	size_t numVertices = geometry->vertices.size();
+	bool equal = hasEqualEntries(geometry->normals, numVertices, a, b) && hasEqualEntries(geometry->uvs, numVertices, a, b);
+	equal &= hasEqualEntries(geometry->colors, numVertices, a, b) && hasEqualEntries(geometry->tangents, numVertices, a, b);
+	equal &= hasEqualEntries(geometry->jointWeights, numVertices, a, b);
+	for (size_t i = 0; i < geometry->extraUVSets.size() && equal; i++)
+		equal = hasEqualEntries(geometry->extraUVSets[i], numVertices, a, b);
+	return equal;
+}
+
+static glm::vec3 getTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	return glm::cross(p1 - p0, p2 - p0);
+}
+
+
+MeshSimplifier::MeshSimplifier(GeometryData* geometry)
+{
+	this->geometry = geometry;
+	error = 0;
+	hasQuadrics = false;
+	size_t numVertices = geometry->vertices.size();
+	// scale to the unit cube so that the error is relative to the extent of the mesh
+	glm::vec3 minimum(0), maximum(0);
+	for (size_t i = 0; i < numVertices; i++){
+		const Vertex& v = geometry->vertices[i];
+		glm::vec3 p(v.x, v.y, v.z);
+		minimum = i == 0 ? p : glm::min(minimum, p);
+		maximum = i == 0 ? p : glm::max(maximum, p);
+	}
+	glm::vec3 size = maximum - minimum;
+	float extent = std::max(size.x, std::max(size.y, size.z));
+	float scale = extent > 0 ? 1.0f / extent : 1.0f;
+	positions.resize(numVertices);
+	for (size_t i = 0; i < numVertices; i++){
+		const Vertex& v = geometry->vertices[i];
+		positions[i] = (glm::vec3(v.x, v.y, v.z) - minimum) * scale;
+	}
+	// vertices with the same position, e.g. the two sides of a uv seam, share one position id
+	std::vector<unsigned int> order(numVertices);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){
+		const glm::vec3& pa = positions[a];
+		const glm::vec3& pb = positions[b];
+		if (pa.x != pb.x)
+			return pa.x < pb.x;
+		if (pa.y != pb.y)
+			return pa.y < pb.y;
+		if (pa.z != pb.z)
+			return pa.z < pb.z;
+		return a < b;
+	});
+	positionIds.resize(numVertices);
+	for (size_t i = 0; i < numVertices; i++){
+		bool same = i > 0 && positions[order[i]] == positions[order[i - 1]];
+		positionIds[order[i]] = same ? positionIds[order[i - 1]] : order[i];
+	}
+	// without welding every polygon has its own copies of the vertices, which would make each edge open,
+	// so copies with equal attributes are merged and only copies with different ones remain as seam sides
+	vertexIds.resize(numVertices);
+	std::vector<unsigned int> distinct; // vertices with different attributes at the current position
+	for (size_t i = 0; i < numVertices; i++){
+		unsigned int v = order[i];
+		if (i == 0 || positionIds[v] != positionIds[order[i - 1]])
+			distinct.clear();
+		vertexIds[v] = v;
+		for (size_t j = 0; j < distinct.size(); j++){
+			if (hasEqualAttributes(geometry, distinct[j], v)){
+				vertexIds[v] = distinct[j];
+				break;
+			}
+		}
+		if (vertexIds[v] == v)
+			distinct.push_back(v);
+	}
+}
+
+void MeshSimplifier::initializeQuadrics(const std::vector<unsigned int>& indices, const std::vector<unsigned char>& kinds,
+										const std::vector<int>& openOut)
+{
+	Quadric zero = {};
+	quadrics.assign(positions.size(), zero);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3){
+		const glm::vec3& p0 = positions[indices[t]];
+		const glm::vec3& p1 = positions[indices[t + 1]];
+		const glm::vec3& p2 = positions[indices[t + 2]];
+		glm::vec3 normal = getTriangleNormal(p0, p1, p2);
+		float length = std::sqrt(glm::dot(normal, normal));
+		if (length <= 0)
+			continue;
+		normal *= 1.0f / length;
+		// the triangle plane weighted by its area
+		for (int k = 0; k < 3; k++){
+			addPlane(quadrics[positionIds[indices[t + k]]], normal.x, normal.y, normal.z, -glm::dot(normal, p0), 0.5 * length);
+		}
+		// planes perpendicular to the triangle through its border and seam edges keep the outline in place
+		for (int k = 0; k < 3; k++){
+			unsigned int v0 = indices[t + k];
+			unsigned int v1 = indices[t + (k + 1) % 3];
+			if ((kinds[v0] != VERTEX_BORDER && kinds[v0] != VERTEX_SEAM) || openOut[v0] != (int)v1)
+				continue;
+			glm::vec3 edge = positions[v1] - positions[v0];
+			glm::vec3 edgeNormal = glm::cross(edge, normal);
+			float edgeLength = std::sqrt(glm::dot(edgeNormal, edgeNormal));
+			if (edgeLength <= 0)
+				continue;
+			edgeNormal *= 1.0f / edgeLength;
+			double d = -glm::dot(edgeNormal, positions[v0]);
+			double weight = glm::dot(edge, edge) * BOUNDARY_WEIGHT;
+			addPlane(quadrics[positionIds[v0]], edgeNormal.x, edgeNormal.y, edgeNormal.z, d, weight);
+			addPlane(quadrics[positionIds[v1]], edgeNormal.x, edgeNormal.y, edgeNormal.z, d, weight);
+		}
+	}
+}
+
+// fraction of the skin weights that differs between two vertices, in [0, 1]
+float MeshSimplifier::getJointWeightDistance(unsigned int v0, unsigned int v1)
+{
+	if (geometry->jointWeights.size() != positions.size())
+		return 0;
+	const VertexJointData& w0 = geometry->jointWeights[v0];
+	const VertexJointData& w1 = geometry->jointWeights[v1];
+	float distance = 0;
+	for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+		if (w0.IDs[i] >= 0){
+			float other = 0;
+			for (int j = 0; j < NUM_JOINTS_PER_VEREX; j++){
+				if (w1.IDs[j] == w0.IDs[i])
+					other = w1.Weights[j];
+			}
+			distance += std::fabs(w0.Weights[i] - other);
+		}
+		if (w1.IDs[i] >= 0){
+			bool shared = false;
+			for (int j = 0; j < NUM_JOINTS_PER_VEREX; j++){
+				shared |= w0.IDs[j] == w1.IDs[i];
+			}
+			if (!shared)
+				distance += w1.Weights[i];
+		}
+	}
+	return std::min(0.5f * distance, 1.0f);
+}
+
+void MeshSimplifier::simplify(std::vector<unsigned int>& indices, size_t targetNumTriangles)
+{
+	size_t numVertices = positions.size();
+	std::vector<int> wedge(numVertices); // next vertex of the same position in a cycle over the referenced vertices
+	std::vector<int> firstWedge(numVertices);
+	std::vector<unsigned int> edgeOffsets(numVertices + 1); // outgoing edges of each vertex
+	std::vector<unsigned int> edgeTargets;
+	std::vector<unsigned int> triangleOffsets(numVertices + 1); // triangles of each vertex
+	std::vector<unsigned int> vertexTriangles;
+	std::vector<int> openOut(numVertices);
+	std::vector<int> openIn(numVertices);
+	std::vector<unsigned char> kinds(numVertices);
+	std::vector<unsigned char> locked(numVertices);
+	std::vector<unsigned int> collapseRemap(numVertices);
+	std::vector<EdgeCollapse> collapses;
+	for (size_t i = 0; i < indices.size(); i++){
+		indices[i] = vertexIds[indices[i]];
+	}
+	while (indices.size() / 3 > targetNumTriangles){
+		size_t numTriangles = indices.size() / 3;
+		indices.resize(numTriangles * 3);
+		// adjacency of the current triangles
+		std::fill(firstWedge.begin(), firstWedge.end(), -1);
+		std::fill(edgeOffsets.begin(), edgeOffsets.end(), 0);
+		for (size_t i = 0; i < indices.size(); i++){
+			unsigned int v = indices[i];
+			edgeOffsets[v + 1]++;
+			int& first = firstWedge[positionIds[v]];
+			if (first < 0){
+				first = v;
+				wedge[v] = v;
+			}
+			else if (edgeOffsets[v + 1] == 1){
+				wedge[v] = wedge[first];
+				wedge[first] = v;
+			}
+		}
+		for (size_t i = 0; i < numVertices; i++){
+			edgeOffsets[i + 1] += edgeOffsets[i];
+		}
+		triangleOffsets = edgeOffsets;
+		edgeTargets.resize(indices.size());
+		vertexTriangles.resize(indices.size());
+		{
+			std::vector<unsigned int> edgeCursor(edgeOffsets.begin(), edgeOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++){
+				unsigned int v = indices[i];
+				unsigned int cursor = edgeCursor[v]++;
+				edgeTargets[cursor] = indices[i - i % 3 + (i + 1) % 3];
+				vertexTriangles[cursor] = (unsigned int)(i / 3);
+			}
+		}
+		// an edge is open if the neighbouring triangle does not use the same two vertices in reverse
+		std::fill(openOut.begin(), openOut.end(), -1);
+		std::fill(openIn.begin(), openIn.end(), -1);
+		for (unsigned int v = 0; v < numVertices; v++){
+			for (unsigned int e = edgeOffsets[v]; e < edgeOffsets[v + 1]; e++){
+				unsigned int target = edgeTargets[e];
+				bool closed = false;
+				for (unsigned int r = edgeOffsets[target]; r < edgeOffsets[target + 1] && !closed; r++){
+					closed = edgeTargets[r] == v;
+				}
+				if (closed)
+					continue;
+				openOut[v] = openOut[v] == -1 ? (int)target : -2;
+				openIn[target] = openIn[target] == -1 ? (int)v : -2;
+			}
+		}
+		for (unsigned int v = 0; v < numVertices; v++){
+			if (edgeOffsets[v + 1] == edgeOffsets[v] || firstWedge[positionIds[v]] != (int)v)
+				continue;
+			int w = wedge[v];
+			unsigned char kind = VERTEX_LOCKED;
+			if (w == (int)v){
+				if (openIn[v] == -1 && openOut[v] == -1)
+					kind = VERTEX_MANIFOLD;
+				else if (openIn[v] >= 0 && openOut[v] >= 0)
+					kind = VERTEX_BORDER;
+			}
+			else if (wedge[w] == (int)v && openIn[v] >= 0 && openOut[v] >= 0 && openIn[w] >= 0 && openOut[w] >= 0){
+				if (positionIds[openIn[v]] == positionIds[openOut[w]] && positionIds[openOut[v]] == positionIds[openIn[w]] &&
+					positionIds[openIn[v]] != positionIds[openOut[v]])
+					kind = VERTEX_SEAM;
+			}
+			kinds[v] = kind;
+			kinds[w] = kind;
+			for (int u = wedge[w]; u != (int)v; u = wedge[u])
+				kinds[u] = kind;
+		}
+		if (!hasQuadrics){
+			initializeQuadrics(indices, kinds, openOut);
+			hasQuadrics = true;
+		}
+
+		// candidates in both directions of each edge sorted by their error, the reverse of a closed edge is part of another triangle
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i++){
+			unsigned int a = indices[i];
+			unsigned int b = indices[i - i % 3 + (i + 1) % 3];
+			for (int direction = 0; direction < 2; direction++){
+				unsigned int v0 = direction == 0 ? a : b;
+				unsigned int v1 = direction == 0 ? b : a;
+				if (direction == 1 && openIn[b] != (int)a)
+					continue;
+				unsigned char k0 = kinds[v0];
+				if (positionIds[v0] == positionIds[v1] || !CAN_COLLAPSE[k0][kinds[v1]])
+					continue;
+				// border and seam vertices only move along their open edges
+				if ((k0 == VERTEX_BORDER || k0 == VERTEX_SEAM) && openOut[v0] != (int)v1 && openIn[v0] != (int)v1)
+					continue;
+				EdgeCollapse collapse;
+				collapse.v0 = collapse.s0 = v0;
+				collapse.v1 = collapse.s1 = v1;
+				if (k0 == VERTEX_SEAM){
+					// the other side follows along its open edge to the same position
+					collapse.s0 = wedge[v0];
+					int s1 = openOut[v0] == (int)v1 ? openIn[collapse.s0] : openOut[collapse.s0];
+					if (s1 < 0 || positionIds[s1] != positionIds[v1])
+						continue;
+					collapse.s1 = s1;
+				}
+				glm::vec3 edge = positions[v1] - positions[v0];
+				float weightDistance = std::max(getJointWeightDistance(v0, v1), getJointWeightDistance(collapse.s0, collapse.s1));
+				double cost = evaluateQuadric(quadrics[positionIds[v0]], positions[v1]);
+				cost += weightDistance * weightDistance * glm::dot(edge, edge);
+				collapse.cost = (float)cost;
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b){
+			return a.cost < b.cost;
+		});
+
+		// apply the cheapest collapses whose neighbourhoods do not overlap
+		std::fill(locked.begin(), locked.end(), 0);
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		size_t goal = numTriangles - targetNumTriangles;
+		size_t removed = 0;
+		for (size_t c = 0; c < collapses.size() && removed < goal; c++){
+			const EdgeCollapse& collapse = collapses[c];
+			unsigned int p0 = positionIds[collapse.v0];
+			unsigned int p1 = positionIds[collapse.v1];
+			if (locked[p0] || locked[p1])
+				continue;
+			bool flipped = false;
+			unsigned int u = collapse.v0;
+			do{
+				for (unsigned int e = triangleOffsets[u]; e < triangleOffsets[u + 1] && !flipped; e++){
+					const unsigned int* triangle = &indices[vertexTriangles[e] * 3];
+					glm::vec3 before[3], after[3];
+					bool removedTriangle = false;
+					for (int k = 0; k < 3; k++){
+						before[k] = positions[triangle[k]];
+						after[k] = positionIds[triangle[k]] == p0 ? positions[collapse.v1] : before[k];
+						removedTriangle |= positionIds[triangle[k]] == p1;
+					}
+					if (removedTriangle)
+						continue;
+					glm::vec3 n0 = getTriangleNormal(before[0], before[1], before[2]);
+					glm::vec3 n1 = getTriangleNormal(after[0], after[1], after[2]);
+					if (glm::dot(n0, n0) <= 0)
+						continue;
+					flipped = glm::dot(n0, n1) <= MIN_NORMAL_COS * std::sqrt(glm::dot(n0, n0) * glm::dot(n1, n1));
+				}
+				u = wedge[u];
+			} while (u != collapse.v0 && !flipped);
+			if (flipped)
+				continue;
+			collapseRemap[collapse.v0] = collapse.v1;
+			collapseRemap[collapse.s0] = collapse.s1;
+			addQuadric(quadrics[p1], quadrics[p0]);
+			// lock the positions of all touched triangles for the rest of this pass
+			do{
+				for (unsigned int e = triangleOffsets[u]; e < triangleOffsets[u + 1]; e++){
+					const unsigned int* triangle = &indices[vertexTriangles[e] * 3];
+					for (int k = 0; k < 3; k++)
+						locked[positionIds[triangle[k]]] = 1;
+				}
+				u = wedge[u];
+			} while (u != collapse.v0);
+			removed += kinds[collapse.v0] == VERTEX_BORDER ? 1 : 2;
+			error = std::max(error, std::sqrt(collapse.cost));
+		}
+		if (removed == 0)
+			break;
+
+		// remove the triangles that became degenerate
+		size_t numKept = 0;
+		for (size_t t = 0; t < indices.size(); t += 3){
+			unsigned int v0 = collapseRemap[indices[t]];
+			unsigned int v1 = collapseRemap[indices[t + 1]];
+			unsigned int v2 = collapseRemap[indices[t + 2]];
+			if (positionIds[v0] == positionIds[v1] || positionIds[v1] == positionIds[v2] || positionIds[v0] == positionIds[v2])
+				continue;
+			indices[numKept++] = v0;
+			indices[numKept++] = v1;
+			indices[numKept++] = v2;
+		}
+		indices.resize(numKept);
+	}
+}
+
+
+void getTriangleIndices(GeometryData* geometry, std::vector<unsigned int>& triangles)
+{
+	size_t numIndices = geometry->getNumIndices();
+	triangles.clear();
+	if (geometry->nPolyVertices == 4){
+		triangles.reserve(numIndices / 4 * 6);
+		for (size_t i = 0; i + 3 < numIndices; i += 4){
+			unsigned int quad[4] = { geometry->getIndex(i), geometry->getIndex(i + 1), geometry->getIndex(i + 2), geometry->getIndex(i + 3) };
+			triangles.insert(triangles.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+		}
+		return;
+	}
+	triangles.resize(numIndices - numIndices % 3);
+	for (size_t i = 0; i < triangles.size(); i++){
+		triangles[i] = geometry->getIndex(i);
+	}
+}
+
+void generateLods(GeometryData* geometry, const std::vector<float>& ratios)
+{
+	std::vector<float> sortedRatios(ratios);
+	std::sort(sortedRatios.begin(), sortedRatios.end(), [](float a, float b){ return a > b; });
+	std::vector<unsigned int> indices;
+	getTriangleIndices(geometry, indices);
+	size_t numTriangles = indices.size() / 3;
+	MeshSimplifier simplifier(geometry);
+	for (size_t i = 0; i < sortedRatios.size(); i++){
+		float ratio = std::min(std::max(sortedRatios[i], 0.0f), 1.0f);
+		simplifier.simplify(indices, (size_t)(ratio * numTriangles + 0.5f));
+		MeshLod lod;
+		lod.ratio = sortedRatios[i];
+		lod.error = simplifier.error;
+		lod.indices = indices;
+		geometry->lods.push_back(lod);
+	}
+}
\ No newline at end of file
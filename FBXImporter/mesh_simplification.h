@@ -0,0 +1,67 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef MESH_SIMPLIFICATION_H_
+#define MESH_SIMPLIFICATION_H_
+#include <vector>
+#include <glm\vec3.hpp>
+
+class GeometryData;
+
+// accumulated squared distances to planes, a*x + b*y + c*z + d = 0, weighted by area or edge length
+struct Quadric{
+	double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+	double weight;
+};
+
+// quadric error simplification by half edge collapses onto existing vertices, so that the simplified
+// triangles reuse the normals, uvs and joint weights of the mesh. Vertices on uv seams are only collapsed
+// along the seam on both sides at once, border vertices along the border and vertices where more than
+// two sides meet are kept. Collapses between vertices with different joint weights are penalized.
+// Copies of a vertex with equal attributes, e.g. the corners of meshes that were not welded, are merged first.
+class MeshSimplifier{
+	public:
+		MeshSimplifier(GeometryData* geometry);
+		// collapses edges of the triangle list until at most targetNumTriangles remain or no collapse is possible,
+		// the quadrics are kept between calls so that a chain of levels measures the error to the original mesh
+		void simplify(std::vector<unsigned int>& indices, size_t targetNumTriangles);
+		float error; // largest error of the collapses so far relative to the extent of the mesh
+	private:
+		GeometryData* geometry;
+		std::vector<glm::vec3> positions; // scaled to the unit cube
+		std::vector<unsigned int> positionIds; // first vertex with the same position
+		std::vector<unsigned int> vertexIds; // first vertex with the same position and attributes
+		std::vector<Quadric> quadrics; // per position id
+		bool hasQuadrics;
+		void initializeQuadrics(const std::vector<unsigned int>& indices, const std::vector<unsigned char>& kinds,
+								const std::vector<int>& openOut);
+		float getJointWeightDistance(unsigned int v0, unsigned int v1);
+};
+
+// triangle list of the polygons of the mesh, quads are split into two triangles
+void getTriangleIndices(GeometryData* geometry, std::vector<unsigned int>& triangles);
+// appends one level per ratio of the triangles of the mesh to geometry->lods, the levels are simplified from each other
+// in order of decreasing ratio
+void generateLods(GeometryData* geometry, const std::vector<float>& ratios);
+
+#endif //MESH_SIMPLIFICATION_H_
\ No newline at end of file
@@ -0,0 +1,70 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef PARALLEL_FOR_H_
+#define PARALLEL_FOR_H_
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// number of threads used for count tasks, numThreads <= 0 uses all cores
+inline int getNumWorkerThreads(int numThreads, int count){
+	if (numThreads <= 0)
+		numThreads = std::thread::hardware_concurrency();
+	if (numThreads > count)
+		numThreads = count;
+	if (numThreads < 1)
+		numThreads = 1;
+	return numThreads;
+}
+
+// calls func(i, worker) for every i in [0, count) on up to numThreads worker threads,
+// worker is the index of the calling thread in [0, getNumWorkerThreads(numThreads, count))
+template<typename Func>
+void parallelForWorkers(int count, int numThreads, Func func){
+	numThreads = getNumWorkerThreads(numThreads, count);
+	if (numThreads == 1){
+		for (int i = 0; i < count; i++)
+			func(i, 0);
+		return;
+	}
+	std::atomic<int> next(0);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < numThreads; t++){
+		workers.push_back(std::thread([&, t](){
+			for (int i = next++; i < count; i = next++)
+				func(i, t);
+		}));
+	}
+	for (auto it = workers.begin(); it != workers.end(); it++){
+		it->join();
+	}
+}
+
+// calls func(i) for every i in [0, count) on up to numThreads worker threads
+template<typename Func>
+void parallelFor(int count, int numThreads, Func func){
+	parallelForWorkers(count, numThreads, [&](int i, int){ func(i); });
+}
+
+#endif //PARALLEL_FOR_H_
\ No newline at end of file
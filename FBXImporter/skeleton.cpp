@@ -25,73 +25,119 @@
 #include <glm\glm.hpp>
 #include <graphic_types.h>
 #include <geometry_data.h>
+#include <skinning.h>
 
 Skeleton::Skeleton(){
 	root = "";
     frameTime = 0.013889;
 	joints = std::map<std::string, Joint*>();
 	jointOrder = std::vector<std::string>();
-	cachedTransformations = std::vector<glm::mat4>();
-	while (cachedTransformations.size() < MAX_BONES){
-		cachedTransformations.push_back(glm::mat4());
-	}
 }
 
 
 
 Skeleton::~Skeleton(){
+	for (auto it = joints.begin(); it != joints.end(); it++){
+		delete it->second;
+	}
+	joints.clear();
+}
+
 
+// appends an animated joint, its parent has to be added before, the local transformation is initialized from the offset and rotation
+int Skeleton::addJoint(Joint* joint){
+	int parentIndex = getJointIndex(joint->parent);
+	joint->index = jointOrder.size();
+	joints[joint->name] = joint;
+	jointIndices[joint->name] = joint->index;
+	jointOrder.push_back(joint->name);
+	parentIndices.push_back(parentIndex);
+	glm::mat4 localTransformation = glm::toMat4(joint->rotation);
+	localTransformation[3] = glm::vec4(joint->offset, 1);
+	localTransformations.push_back(localTransformation);
+	globalTransformations.push_back(localTransformation);
+	inverseBindPoses.push_back(glm::mat4());
+	if (parentIndex >= 0){
+		joints[joint->parent]->children.push_back(joint);
+	}
+	return joint->index;
 }
 
 
-void Skeleton::updateCacheFromOffset(){
-	glm::mat4 parentT = glm::mat4();
-	joints[root]->updateCacheFromOffset(parentT);
+void Skeleton::addEndSite(Joint* joint){
+	joint->index = -1;
+	joints[joint->name] = joint;
+	auto parent = joints.find(joint->parent);
+	if (parent != joints.end()){
+		parent->second->children.push_back(joint);
+	}
+}
 
+
+void Skeleton::updateCacheFromOffset(){
+	// parents precede their children, so a single pass over the joints is enough
+	for (size_t i = 0; i < parentIndices.size(); i++){
+		int parentIndex = parentIndices[i];
+		if (parentIndex >= 0)
+			globalTransformations[i] = globalTransformations[parentIndex] * localTransformations[i];
+		else
+			globalTransformations[i] = localTransformations[i];
+	}
 }
 
 
-int Skeleton::getJointIndex(const char* name){
-	auto pos = std::find(jointOrder.begin(), jointOrder.end(), name);
-	if (pos != jointOrder.end())
-		return pos - jointOrder.begin();
+int Skeleton::getJointIndex(const std::string& name){
+	auto pos = jointIndices.find(name);
+	if (pos != jointIndices.end())
+		return pos->second;
 	else
 		return -1;
 }
 
 
+int Skeleton::getJointIndex(const char* name){
+	return getJointIndex(std::string(name));
+}
+
+
 void Skeleton::setInverseBindPoseFromOffset(){
 	updateCacheFromOffset();
-	for (auto it = joints.begin(); it != joints.end(); it++){
-		 glm::mat4 inverse = glm::inverse(joints[it->first]->cachedGlobalTransformationMatrix);
-		 joints[it->first]->invBindPose = inverse;
+	for (size_t i = 0; i < globalTransformations.size(); i++){
+		inverseBindPoses[i] = glm::inverse(globalTransformations[i]);
 	}
 }
 
 void Skeleton::resetOffset(){
-	for (auto it = joints.begin(); it != joints.end(); it++){
-		joints[it->first]->offsetMatrix = glm::mat4();
+	for (size_t i = 0; i < jointOrder.size(); i++){
+		Joint* joint = joints[jointOrder[i]];
+		localTransformations[i] = glm::toMat4(joint->rotation);
+		localTransformations[i][3] = glm::vec4(joint->offset, 1);
 	}
 }
 
 
 std::vector<Vertex>* Skeleton::generateVertices(){
 	std::vector<Vertex>* vertices = new std::vector<Vertex>();
-	joints[root]->addVertexRecursively(vertices, NULL);
+	auto rootJoint = joints.find(root);
+	if (rootJoint != joints.end())
+		rootJoint->second->addVertexRecursively(vertices, NULL);
 	return vertices;
 }
 
 std::vector<Vertex>* Skeleton::transformVertices(GeometryData* geometry){
-	std::vector<Vertex>* vertices = new std::vector<Vertex>();
-	for (int i = 0; i < geometry->jointWeights.size(); i++){
-		glm::vec4 v = glm::vec4(0,0,0,1);
-		for (int j = 0; j < 4; j++){
-			int id = geometry->jointWeights[i].IDs[j];
-			if (id >= 0 && id <jointOrder.size()){
-				v += geometry->jointWeights[i].Weights[j] * joints[jointOrder[id]]->cachedGlobalTransformationMatrix* joints[jointOrder[id]]->invBindPose * geometry->vertices[i].toglmVec();
-			}
-		}
-		vertices->push_back(Vertex(v));
+	std::vector<glm::mat4> palette;
+	computeSkinningPalette(this, palette);
+	SkinnedMesh mesh(geometry, palette.size());
+	std::vector<float> positions[3];
+	float* outPositions[3];
+	for (int c = 0; c < 3; c++){
+		positions[c].resize(mesh.numVertices);
+		outPositions[c] = positions[c].data();
+	}
+	skinVertices(mesh.getInput(), (const float*)palette.data(), outPositions, NULL);
+	std::vector<Vertex>* vertices = new std::vector<Vertex>(mesh.numVertices);
+	for (int i = 0; i < mesh.numVertices; i++){
+		(*vertices)[i] = Vertex(positions[0][i], positions[1][i], positions[2][i]);
 	}
 	return vertices;
 }
\ No newline at end of file
@@ -27,9 +27,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "joint.h"
 
-static const int MAX_BONES = 100;
 class Vertex;
 class GeometryData;
 class Skeleton{
@@ -37,16 +37,25 @@ public:
 	Skeleton();
 	~Skeleton();
 	
+	int addJoint(Joint* joint);
+	void addEndSite(Joint* joint);
 	void updateCacheFromOffset();
 	void resetOffset();
 	void setInverseBindPoseFromOffset();
+	int getJointIndex(const std::string& name);
 	int getJointIndex(const char* name);
 	std::vector<Vertex>* generateVertices();
 	std::vector<Vertex>* transformVertices(GeometryData* geometry);
 	std::string root;
+	// all joints including the end sites, the animated joints are also stored by index in the arrays below
 	std::map<std::string, Joint*> joints;
+	// animated joints in topological order, i.e. each parent is stored before its children
 	std::vector<std::string> jointOrder;
-	std::vector<glm::mat4> cachedTransformations;
+	std::vector<int> parentIndices;
+	std::vector<glm::mat4> localTransformations;
+	std::vector<glm::mat4> globalTransformations;
+	std::vector<glm::mat4> inverseBindPoses;
+	std::unordered_map<std::string, int> jointIndices;
     double frameTime;
 };
 
@@ -0,0 +1,290 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "skinning.h"
+#include "skeleton.h"
+#include "geometry_data.h"
+#include <cmath>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SKINNING_AVX2_TARGET
+#else
+#define SKINNING_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#define SKINNING_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SKINNING_SSE2
+#endif
+
+// squared length below which a skinned normal is not normalized
+static const float MIN_NORMAL_LENGTH2 = 1e-30f;
+
+
+SkinnedMesh::SkinnedMesh(GeometryData* geometry, int numJoints)
+{
+	numVertices = (int)geometry->vertices.size();
+	bool hasNormals = geometry->normals.size() == geometry->vertices.size();
+	for (int c = 0; c < 3; c++){
+		positions[c].resize(numVertices);
+		if (hasNormals)
+			normals[c].resize(numVertices);
+	}
+	for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+		jointIndices[i].assign(numVertices, 0);
+		weights[i].assign(numVertices, 0.0f);
+	}
+	for (int v = 0; v < numVertices; v++){
+		positions[0][v] = geometry->vertices[v].x;
+		positions[1][v] = geometry->vertices[v].y;
+		positions[2][v] = geometry->vertices[v].z;
+		if (hasNormals){
+			normals[0][v] = geometry->normals[v].x;
+			normals[1][v] = geometry->normals[v].y;
+			normals[2][v] = geometry->normals[v].z;
+		}
+		if (v >= (int)geometry->jointWeights.size())
+			continue;
+		VertexJointData& jointData = geometry->jointWeights[v];
+		for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+			if (jointData.IDs[i] >= 0 && jointData.IDs[i] < numJoints){
+				jointIndices[i][v] = jointData.IDs[i];
+				weights[i][v] = jointData.Weights[i];
+			}
+		}
+	}
+}
+
+
+SkinningInput SkinnedMesh::getInput()
+{
+	SkinningInput input;
+	input.numVertices = numVertices;
+	for (int c = 0; c < 3; c++){
+		input.positions[c] = positions[c].data();
+		input.normals[c] = normals[c].size() > 0 ? normals[c].data() : NULL;
+	}
+	for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+		input.jointIndices[i] = jointIndices[i].data();
+		input.weights[i] = weights[i].data();
+	}
+	return input;
+}
+
+
+void computeSkinningPalette(Skeleton* skeleton, std::vector<glm::mat4>& palette)
+{
+	palette.resize(skeleton->globalTransformations.size());
+	for (size_t i = 0; i < palette.size(); i++){
+		palette[i] = skeleton->globalTransformations[i] * skeleton->inverseBindPoses[i];
+	}
+}
+
+
+SkinningKernel getBestSkinningKernel()
+{
+#ifdef SKINNING_AVX2
+#if defined(_MSC_VER)
+	static const bool hasAvx2 = [](){
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		// the os has to save the ymm registers
+		if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	}();
+#else
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	if (hasAvx2)
+		return SKINNING_KERNEL_AVX2;
+#endif
+#ifdef SKINNING_SSE2
+	return SKINNING_KERNEL_SSE2;
+#else
+	return SKINNING_KERNEL_SCALAR;
+#endif
+}
+
+
+// the blended matrix is stored as 4 columns of the upper 3 rows, m[c * 3 + r]
+static void skinVerticesScalar(const SkinningInput& input, const float* palette, int first, int last, float* outPositions[3], float* outNormals[3])
+{
+	for (int v = first; v < last; v++){
+		float m[12] = { 0 };
+		for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+			float w = input.weights[i][v];
+			if (w == 0.0f)
+				continue;
+			const float* p = palette + input.jointIndices[i][v] * 16;
+			for (int c = 0; c < 4; c++){
+				for (int r = 0; r < 3; r++)
+					m[c * 3 + r] += w * p[c * 4 + r];
+			}
+		}
+		float x = input.positions[0][v];
+		float y = input.positions[1][v];
+		float z = input.positions[2][v];
+		for (int r = 0; r < 3; r++)
+			outPositions[r][v] = m[r] * x + m[3 + r] * y + m[6 + r] * z + m[9 + r];
+		if (outNormals == NULL)
+			continue;
+		float nx = input.normals[0][v];
+		float ny = input.normals[1][v];
+		float nz = input.normals[2][v];
+		float n[3];
+		for (int r = 0; r < 3; r++)
+			n[r] = m[r] * nx + m[3 + r] * ny + m[6 + r] * nz;
+		float length2 = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+		float scale = length2 > MIN_NORMAL_LENGTH2 ? 1.0f / sqrt(length2) : 1.0f;
+		for (int r = 0; r < 3; r++)
+			outNormals[r][v] = n[r] * scale;
+	}
+}
+
+
+#ifdef SKINNING_SSE2
+// 4 vertices per iteration, the palette entries of each lane are loaded separately
+static void skinVerticesSse2(const SkinningInput& input, const float* palette, int last, float* outPositions[3], float* outNormals[3])
+{
+	for (int v = 0; v + 4 <= last; v += 4){
+		__m128 m[12];
+		for (int k = 0; k < 12; k++)
+			m[k] = _mm_setzero_ps();
+		for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+			__m128 w = _mm_loadu_ps(input.weights[i] + v);
+			const int* ids = input.jointIndices[i] + v;
+			const float* p0 = palette + ids[0] * 16;
+			const float* p1 = palette + ids[1] * 16;
+			const float* p2 = palette + ids[2] * 16;
+			const float* p3 = palette + ids[3] * 16;
+			for (int c = 0; c < 4; c++){
+				for (int r = 0; r < 3; r++){
+					int k = c * 4 + r;
+					m[c * 3 + r] = _mm_add_ps(m[c * 3 + r], _mm_mul_ps(w, _mm_setr_ps(p0[k], p1[k], p2[k], p3[k])));
+				}
+			}
+		}
+		__m128 x = _mm_loadu_ps(input.positions[0] + v);
+		__m128 y = _mm_loadu_ps(input.positions[1] + v);
+		__m128 z = _mm_loadu_ps(input.positions[2] + v);
+		for (int r = 0; r < 3; r++){
+			__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[r], x), _mm_mul_ps(m[3 + r], y)), _mm_add_ps(_mm_mul_ps(m[6 + r], z), m[9 + r]));
+			_mm_storeu_ps(outPositions[r] + v, p);
+		}
+		if (outNormals == NULL)
+			continue;
+		__m128 nx = _mm_loadu_ps(input.normals[0] + v);
+		__m128 ny = _mm_loadu_ps(input.normals[1] + v);
+		__m128 nz = _mm_loadu_ps(input.normals[2] + v);
+		__m128 n[3];
+		for (int r = 0; r < 3; r++)
+			n[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[r], nx), _mm_mul_ps(m[3 + r], ny)), _mm_mul_ps(m[6 + r], nz));
+		__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n[0], n[0]), _mm_mul_ps(n[1], n[1])), _mm_mul_ps(n[2], n[2]));
+		__m128 valid = _mm_cmpgt_ps(length2, _mm_set1_ps(MIN_NORMAL_LENGTH2));
+		__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(length2, _mm_set1_ps(MIN_NORMAL_LENGTH2))));
+		scale = _mm_or_ps(_mm_and_ps(valid, scale), _mm_andnot_ps(valid, _mm_set1_ps(1.0f)));
+		for (int r = 0; r < 3; r++)
+			_mm_storeu_ps(outNormals[r] + v, _mm_mul_ps(n[r], scale));
+	}
+}
+#endif
+
+
+#ifdef SKINNING_AVX2
+// 8 vertices per iteration, the palette entries are gathered by joint index
+SKINNING_AVX2_TARGET
+static void skinVerticesAvx2(const SkinningInput& input, const float* palette, int last, float* outPositions[3], float* outNormals[3])
+{
+	for (int v = 0; v + 8 <= last; v += 8){
+		__m256 m[12];
+		for (int k = 0; k < 12; k++)
+			m[k] = _mm256_setzero_ps();
+		for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+			__m256 w = _mm256_loadu_ps(input.weights[i] + v);
+			__m256i offsets = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(input.jointIndices[i] + v)), 4);
+			for (int c = 0; c < 4; c++){
+				for (int r = 0; r < 3; r++)
+					m[c * 3 + r] = _mm256_fmadd_ps(w, _mm256_i32gather_ps(palette + c * 4 + r, offsets, 4), m[c * 3 + r]);
+			}
+		}
+		__m256 x = _mm256_loadu_ps(input.positions[0] + v);
+		__m256 y = _mm256_loadu_ps(input.positions[1] + v);
+		__m256 z = _mm256_loadu_ps(input.positions[2] + v);
+		for (int r = 0; r < 3; r++){
+			__m256 p = _mm256_fmadd_ps(m[r], x, _mm256_fmadd_ps(m[3 + r], y, _mm256_fmadd_ps(m[6 + r], z, m[9 + r])));
+			_mm256_storeu_ps(outPositions[r] + v, p);
+		}
+		if (outNormals == NULL)
+			continue;
+		__m256 nx = _mm256_loadu_ps(input.normals[0] + v);
+		__m256 ny = _mm256_loadu_ps(input.normals[1] + v);
+		__m256 nz = _mm256_loadu_ps(input.normals[2] + v);
+		__m256 n[3];
+		for (int r = 0; r < 3; r++)
+			n[r] = _mm256_fmadd_ps(m[r], nx, _mm256_fmadd_ps(m[3 + r], ny, _mm256_mul_ps(m[6 + r], nz)));
+		__m256 length2 = _mm256_fmadd_ps(n[0], n[0], _mm256_fmadd_ps(n[1], n[1], _mm256_mul_ps(n[2], n[2])));
+		__m256 valid = _mm256_cmp_ps(length2, _mm256_set1_ps(MIN_NORMAL_LENGTH2), _CMP_GT_OQ);
+		__m256 scale = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(length2, _mm256_set1_ps(MIN_NORMAL_LENGTH2))));
+		scale = _mm256_blendv_ps(_mm256_set1_ps(1.0f), scale, valid);
+		for (int r = 0; r < 3; r++)
+			_mm256_storeu_ps(outNormals[r] + v, _mm256_mul_ps(n[r], scale));
+	}
+	_mm256_zeroupper();
+}
+#endif
+
+
+void skinVertices(const SkinningInput& input, const float* palette, float* outPositions[3], float* outNormals[3], SkinningKernel kernel)
+{
+	SkinningKernel bestKernel = getBestSkinningKernel();
+	if (kernel == SKINNING_KERNEL_AUTO || kernel > bestKernel)
+		kernel = bestKernel;
+	if (input.normals[0] == NULL)
+		outNormals = NULL;
+	// the simd kernels process whole blocks, the remaining vertices are skinned by the scalar kernel
+	int first = 0;
+#ifdef SKINNING_AVX2
+	if (kernel == SKINNING_KERNEL_AVX2){
+		first = input.numVertices - input.numVertices % 8;
+		skinVerticesAvx2(input, palette, first, outPositions, outNormals);
+	}
+#endif
+#ifdef SKINNING_SSE2
+	if (kernel == SKINNING_KERNEL_SSE2){
+		first = input.numVertices - input.numVertices % 4;
+		skinVerticesSse2(input, palette, first, outPositions, outNormals);
+	}
+#endif
+	skinVerticesScalar(input, palette, first, input.numVertices, outPositions, outNormals);
+}
\ No newline at end of file
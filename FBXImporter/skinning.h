@@ -0,0 +1,71 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef SKINNING_H_
+#define SKINNING_H_
+#include <vector>
+#include <glm\mat4x4.hpp>
+#include "graphic_types.h"
+
+class Skeleton;
+class GeometryData;
+
+enum SkinningKernel{
+	SKINNING_KERNEL_AUTO, // the fastest kernel supported by the cpu
+	SKINNING_KERNEL_SCALAR,
+	SKINNING_KERNEL_SSE2,
+	SKINNING_KERNEL_AVX2
+};
+
+// vertex data in structure of arrays layout, the joint indices must be in [0, numJoints) of the palette,
+// normals may be NULL to only skin the positions
+struct SkinningInput{
+	int numVertices;
+	const float* positions[3];
+	const float* normals[3];
+	const int* jointIndices[NUM_JOINTS_PER_VEREX];
+	const float* weights[NUM_JOINTS_PER_VEREX];
+};
+
+// copy of the vertices and joint weights of a mesh in structure of arrays layout,
+// influences of joints outside of [0, numJoints) get index 0 and weight 0
+class SkinnedMesh{
+	public:
+		SkinnedMesh(GeometryData* geometry, int numJoints);
+		int numVertices;
+		std::vector<float> positions[3];
+		std::vector<float> normals[3];
+		std::vector<int> jointIndices[NUM_JOINTS_PER_VEREX];
+		std::vector<float> weights[NUM_JOINTS_PER_VEREX];
+		SkinningInput getInput();
+};
+
+// global transformation times inverse bind pose of each joint in jointOrder for the cached pose of the skeleton
+void computeSkinningPalette(Skeleton* skeleton, std::vector<glm::mat4>& palette);
+SkinningKernel getBestSkinningKernel();
+// linear blend skinning with a palette of column major 4x4 matrices into caller provided arrays of numVertices
+// floats per component, the output normals are normalized and skipped if outNormals is NULL
+void skinVertices(const SkinningInput& input, const float* palette, float* outPositions[3], float* outNormals[3],
+				  SkinningKernel kernel = SKINNING_KERNEL_AUTO);
+
+#endif //SKINNING_H_
\ No newline at end of file
@@ -0,0 +1,408 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "vertex_quantization.h"
+#include "geometry_data.h"
+#include <algorithm>
+#include <cmath>
+
+static const float QUANTIZED_16_MAX = 65535.0f;
+static const float OCTAHEDRON_MAX = 127.0f;
+static const int WEIGHT_MAX = 255;
+static const float COLOR_MAX = 255.0f;
+
+
+// offset and scale that map [minimum, maximum] to [0, 65535]
+static void getQuantizationRange(float minimum, float maximum, float& offset, float& scale)
+{
+	offset = minimum;
+	scale = maximum > minimum ? (maximum - minimum) / QUANTIZED_16_MAX : 0.0f;
+}
+
+static unsigned short quantize16(float value, float offset, float scale)
+{
+	if (scale <= 0)
+		return 0;
+	float q = (value - offset) / scale + 0.5f;
+	return (unsigned short)std::min(std::max(q, 0.0f), QUANTIZED_16_MAX);
+}
+
+static signed char quantizeSnorm8(float value)
+{
+	float q = std::min(std::max(value, -1.0f), 1.0f) * OCTAHEDRON_MAX;
+	return (signed char)(q >= 0 ? q + 0.5f : q - 0.5f);
+}
+
+static void encodeOctahedron(const Normal& normal, signed char* out)
+{
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length <= 0){
+		out[0] = out[1] = 0;
+		return;
+	}
+	float x = normal.x / length;
+	float y = normal.y / length;
+	// the lower hemisphere is folded over the diagonals
+	if (normal.z < 0){
+		float foldedX = (1.0f - std::fabs(y)) * (x >= 0 ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	out[0] = quantizeSnorm8(x);
+	out[1] = quantizeSnorm8(y);
+}
+
+static void decodeOctahedron(const signed char* in, float* out)
+{
+	float x = in[0] / OCTAHEDRON_MAX;
+	float y = in[1] / OCTAHEDRON_MAX;
+	float z = 1.0f - std::fabs(x) - std::fabs(y);
+	float t = std::max(-z, 0.0f);
+	x += x >= 0 ? -t : t;
+	y += y >= 0 ? -t : t;
+	float length = std::sqrt(x * x + y * y + z * z);
+	out[0] = x / length;
+	out[1] = y / length;
+	out[2] = z / length;
+}
+
+// octahedron encodes 2 values per direction and returns the measured maximum angle error
+static float quantizeDirections(const std::vector<Normal>& directions, std::vector<signed char>& out)
+{
+	float maxError = 0;
+	out.resize(directions.size() * 2);
+	for (size_t v = 0; v < directions.size(); v++){
+		const Normal& direction = directions[v];
+		encodeOctahedron(direction, &out[v * 2]);
+		float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		if (length <= 0)
+			continue;
+		float decoded[3];
+		decodeOctahedron(&out[v * 2], decoded);
+		float cosine = (direction.x * decoded[0] + direction.y * decoded[1] + direction.z * decoded[2]) / length;
+		maxError = std::max(maxError, std::acos(std::min(std::max(cosine, -1.0f), 1.0f)));
+	}
+	return maxError;
+}
+
+// quantizes 2 values per uv within the bounding box of the set and returns the measured maximum component error
+static float quantizeUVSet(const std::vector<UVCoord>& uvs, float* offset, float* scale, std::vector<unsigned short>& out)
+{
+	float minimum[2] = { 0, 0 };
+	float maximum[2] = { 0, 0 };
+	for (size_t v = 0; v < uvs.size(); v++){
+		const float uv[2] = { uvs[v].u, uvs[v].v };
+		for (int k = 0; k < 2; k++){
+			minimum[k] = v == 0 ? uv[k] : std::min(minimum[k], uv[k]);
+			maximum[k] = v == 0 ? uv[k] : std::max(maximum[k], uv[k]);
+		}
+	}
+	for (int k = 0; k < 2; k++){
+		getQuantizationRange(minimum[k], maximum[k], offset[k], scale[k]);
+	}
+	float maxError = 0;
+	out.resize(uvs.size() * 2);
+	for (size_t v = 0; v < uvs.size(); v++){
+		const float uv[2] = { uvs[v].u, uvs[v].v };
+		for (int k = 0; k < 2; k++){
+			unsigned short q = quantize16(uv[k], offset[k], scale[k]);
+			out[v * 2 + k] = q;
+			maxError = std::max(maxError, std::fabs(offset[k] + q * scale[k] - uv[k]));
+		}
+	}
+	return maxError;
+}
+
+static void decodeUVSet(const std::vector<unsigned short>& values, const float* offset, const float* scale, int numVertices, float* out)
+{
+	if (values.size() != (size_t)numVertices * 2)
+		return;
+	for (int v = 0; v < numVertices; v++){
+		for (int k = 0; k < 2; k++){
+			out[v * 2 + k] = offset[k] + values[v * 2 + k] * scale[k];
+		}
+	}
+}
+
+// rounds the normalized weights so that they sum to exactly 255, the rounding remainder goes to the largest weight
+static void quantizeWeights(const VertexJointData& jointData, unsigned char* out)
+{
+	float sum = 0;
+	for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+		if (jointData.IDs[i] >= 0 && jointData.Weights[i] > 0)
+			sum += jointData.Weights[i];
+	}
+	int total = 0;
+	int largest = 0;
+	for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+		float weight = jointData.IDs[i] >= 0 && jointData.Weights[i] > 0 && sum > 0 ? jointData.Weights[i] / sum : 0.0f;
+		out[i] = (unsigned char)(weight * WEIGHT_MAX + 0.5f);
+		total += out[i];
+		if (out[i] > out[largest])
+			largest = i;
+	}
+	if (total > 0)
+		out[largest] = (unsigned char)(out[largest] + WEIGHT_MAX - total);
+}
+
+static void writeVarint(std::vector<unsigned char>& data, unsigned int value)
+{
+	while (value >= 0x80){
+		data.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	data.push_back((unsigned char)value);
+}
+
+
+QuantizedUVSet::QuantizedUVSet()
+{
+	for (int i = 0; i < 2; i++){
+		offset[i] = 0;
+		scale[i] = 0;
+	}
+}
+
+QuantizedMesh::QuantizedMesh()
+{
+	numVertices = 0;
+	for (int i = 0; i < 3; i++){
+		positionOffset[i] = 0;
+		positionScale[i] = 0;
+	}
+	for (int i = 0; i < 2; i++){
+		uvOffset[i] = 0;
+		uvScale[i] = 0;
+	}
+	jointIndexSize = 1;
+	numIndices = 0;
+	maxPositionError = 0;
+	maxNormalError = 0;
+	maxUVError = 0;
+	maxTangentError = 0;
+	maxColorError = 0;
+	maxWeightError = 0;
+}
+
+size_t QuantizedMesh::getNumBytes()
+{
+	size_t numBytes = sizeof(QuantizedMesh);
+	numBytes += positions.capacity() * sizeof(unsigned short) + normals.capacity() + uvs.capacity() * sizeof(unsigned short);
+	numBytes += jointIndices.capacity() + jointIndices16.capacity() * sizeof(unsigned short) + weights.capacity();
+	numBytes += tangents.capacity() + colors.capacity() + indexData.capacity();
+	numBytes += extraUVSets.capacity() * sizeof(QuantizedUVSet);
+	for (size_t i = 0; i < extraUVSets.size(); i++)
+		numBytes += extraUVSets[i].values.capacity() * sizeof(unsigned short);
+	return numBytes;
+}
+
+void QuantizedMesh::decodePositions(float* out)
+{
+	if (positions.size() != (size_t)numVertices * 3)
+		return;
+	for (int v = 0; v < numVertices; v++){
+		for (int k = 0; k < 3; k++){
+			out[v * 3 + k] = positionOffset[k] + positions[v * 3 + k] * positionScale[k];
+		}
+	}
+}
+
+void QuantizedMesh::decodeNormals(float* out)
+{
+	if (normals.size() != (size_t)numVertices * 2)
+		return;
+	for (int v = 0; v < numVertices; v++){
+		decodeOctahedron(&normals[v * 2], &out[v * 3]);
+	}
+}
+
+void QuantizedMesh::decodeUVs(float* out)
+{
+	decodeUVSet(uvs, uvOffset, uvScale, numVertices, out);
+}
+
+void QuantizedMesh::decodeExtraUVs(int uvSet, float* out)
+{
+	if (uvSet < 0 || (size_t)uvSet >= extraUVSets.size())
+		return;
+	decodeUVSet(extraUVSets[uvSet].values, extraUVSets[uvSet].offset, extraUVSets[uvSet].scale, numVertices, out);
+}
+
+void QuantizedMesh::decodeTangents(float* out)
+{
+	if (tangents.size() != (size_t)numVertices * 2)
+		return;
+	for (int v = 0; v < numVertices; v++){
+		decodeOctahedron(&tangents[v * 2], &out[v * 3]);
+	}
+}
+
+void QuantizedMesh::decodeColors(float* out)
+{
+	if (colors.size() != (size_t)numVertices * 4)
+		return;
+	for (size_t i = 0; i < colors.size(); i++){
+		out[i] = colors[i] / COLOR_MAX;
+	}
+}
+
+void QuantizedMesh::decodeJointWeights(int* jointIds, float* jointWeights)
+{
+	if (weights.size() != (size_t)numVertices * NUM_JOINTS_PER_VEREX)
+		return;
+	for (size_t i = 0; i < weights.size(); i++){
+		int jointIndex = jointIndexSize == 2 ? jointIndices16[i] : jointIndices[i];
+		jointIds[i] = weights[i] > 0 ? jointIndex : -1;
+		jointWeights[i] = weights[i] / (float)WEIGHT_MAX;
+	}
+}
+
+bool QuantizedMesh::decodeIndices(unsigned int* out)
+{
+	size_t pos = 0;
+	unsigned int nextVertex = 0;
+	for (int i = 0; i < numIndices; i++){
+		unsigned int value = 0;
+		int shift = 0;
+		for (;;){
+			if (pos >= indexData.size() || shift > 28)
+				return false;
+			unsigned char byte = indexData[pos++];
+			value |= (unsigned int)(byte & 0x7F) << shift;
+			shift += 7;
+			if (!(byte & 0x80))
+				break;
+		}
+		int delta = (int)(value >> 1) ^ -(int)(value & 1);
+		unsigned int index = nextVertex - delta;
+		if (index >= (unsigned int)numVertices)
+			return false;
+		out[i] = index;
+		nextVertex = std::max(nextVertex, index + 1);
+	}
+	return pos == indexData.size();
+}
+
+
+void quantizeMesh(GeometryData* geometry, QuantizedMesh* quantized)
+{
+	size_t numVertices = geometry->vertices.size();
+	quantized->numVertices = (int)numVertices;
+
+	float minimum[3] = { 0, 0, 0 };
+	float maximum[3] = { 0, 0, 0 };
+	for (size_t v = 0; v < numVertices; v++){
+		const float p[3] = { geometry->vertices[v].x, geometry->vertices[v].y, geometry->vertices[v].z };
+		for (int k = 0; k < 3; k++){
+			minimum[k] = v == 0 ? p[k] : std::min(minimum[k], p[k]);
+			maximum[k] = v == 0 ? p[k] : std::max(maximum[k], p[k]);
+		}
+	}
+	for (int k = 0; k < 3; k++){
+		getQuantizationRange(minimum[k], maximum[k], quantized->positionOffset[k], quantized->positionScale[k]);
+	}
+	quantized->positions.resize(numVertices * 3);
+	for (size_t v = 0; v < numVertices; v++){
+		const float p[3] = { geometry->vertices[v].x, geometry->vertices[v].y, geometry->vertices[v].z };
+		float distance2 = 0;
+		for (int k = 0; k < 3; k++){
+			unsigned short q = quantize16(p[k], quantized->positionOffset[k], quantized->positionScale[k]);
+			quantized->positions[v * 3 + k] = q;
+			float d = quantized->positionOffset[k] + q * quantized->positionScale[k] - p[k];
+			distance2 += d * d;
+		}
+		quantized->maxPositionError = std::max(quantized->maxPositionError, std::sqrt(distance2));
+	}
+
+	if (geometry->normals.size() == numVertices)
+		quantized->maxNormalError = quantizeDirections(geometry->normals, quantized->normals);
+
+	if (geometry->uvs.size() == numVertices)
+		quantized->maxUVError = quantizeUVSet(geometry->uvs, quantized->uvOffset, quantized->uvScale, quantized->uvs);
+	for (size_t i = 0; i < geometry->extraUVSets.size(); i++){
+		QuantizedUVSet uvSet;
+		if (geometry->extraUVSets[i].size() == numVertices)
+			quantized->maxUVError = std::max(quantized->maxUVError, quantizeUVSet(geometry->extraUVSets[i], uvSet.offset, uvSet.scale, uvSet.values));
+		quantized->extraUVSets.push_back(uvSet);
+	}
+
+	if (geometry->tangents.size() == numVertices)
+		quantized->maxTangentError = quantizeDirections(geometry->tangents, quantized->tangents);
+
+	if (geometry->colors.size() == numVertices){
+		quantized->colors.resize(numVertices * 4);
+		for (size_t v = 0; v < numVertices; v++){
+			const float color[4] = { geometry->colors[v].r, geometry->colors[v].g, geometry->colors[v].b, geometry->colors[v].a };
+			for (int k = 0; k < 4; k++){
+				float value = std::min(std::max(color[k], 0.0f), 1.0f);
+				unsigned char q = (unsigned char)(value * COLOR_MAX + 0.5f);
+				quantized->colors[v * 4 + k] = q;
+				quantized->maxColorError = std::max(quantized->maxColorError, std::fabs(q / COLOR_MAX - value));
+			}
+		}
+	}
+
+	if (geometry->jointWeights.size() == numVertices){
+		int maxJointIndex = 0;
+		for (size_t v = 0; v < numVertices; v++){
+			for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++)
+				maxJointIndex = std::max(maxJointIndex, geometry->jointWeights[v].IDs[i]);
+		}
+		quantized->jointIndexSize = maxJointIndex <= 0xFF ? 1 : 2;
+		if (quantized->jointIndexSize == 1)
+			quantized->jointIndices.resize(numVertices * NUM_JOINTS_PER_VEREX);
+		else
+			quantized->jointIndices16.resize(numVertices * NUM_JOINTS_PER_VEREX);
+		quantized->weights.resize(numVertices * NUM_JOINTS_PER_VEREX);
+		for (size_t v = 0; v < numVertices; v++){
+			const VertexJointData& jointData = geometry->jointWeights[v];
+			unsigned char* weights = &quantized->weights[v * NUM_JOINTS_PER_VEREX];
+			quantizeWeights(jointData, weights);
+			for (int i = 0; i < NUM_JOINTS_PER_VEREX; i++){
+				int jointIndex = std::max(jointData.IDs[i], 0);
+				if (quantized->jointIndexSize == 1)
+					quantized->jointIndices[v * NUM_JOINTS_PER_VEREX + i] = (unsigned char)jointIndex;
+				else
+					quantized->jointIndices16[v * NUM_JOINTS_PER_VEREX + i] = (unsigned short)jointIndex;
+				float weight = jointData.IDs[i] >= 0 ? jointData.Weights[i] : 0.0f;
+				quantized->maxWeightError = std::max(quantized->maxWeightError, std::fabs(weights[i] / (float)WEIGHT_MAX - weight));
+			}
+		}
+	}
+
+	// each index is predicted as the next unused vertex, in vertex fetch order this is exact for new vertices
+	// and reused ones are recent, so most differences fit into one byte
+	size_t numIndices = geometry->getNumIndices();
+	quantized->numIndices = (int)numIndices;
+	quantized->indexData.clear();
+	quantized->indexData.reserve(numIndices);
+	unsigned int nextVertex = 0;
+	for (size_t i = 0; i < numIndices; i++){
+		unsigned int index = geometry->getIndex(i);
+		int delta = (int)(nextVertex - index);
+		writeVarint(quantized->indexData, ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31));
+		nextVertex = std::max(nextVertex, index + 1);
+	}
+	quantized->indexData.shrink_to_fit();
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+/*
+*
+* Copyright 2019 DFKI GmbH.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files(the
+* "Software"), to deal in the Software without restriction, including
+* without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and / or sell copies of the Software, and to permit
+* persons to whom the Software is furnished to do so, subject to the
+* following conditions :
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN
+* NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+* OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+* USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef VERTEX_QUANTIZATION_H_
+#define VERTEX_QUANTIZATION_H_
+#include <vector>
+#include "graphic_types.h"
+
+class GeometryData;
+
+// a uv set after the first one, quantized to 16 bit within its own bounding box
+struct QuantizedUVSet{
+	QuantizedUVSet();
+	float offset[2]; // uv = offset + value * scale
+	float scale[2];
+	std::vector<unsigned short> values; // 2 per vertex
+};
+
+// compact vertex and index buffers of a mesh, positions and uvs are quantized to 16 bit within their bounding boxes,
+// normals and tangents are octahedron encoded to 2 x 8 bit, colors use 8 bit per channel, joint indices use 8 bit
+// while they fit and the weights 8 bit that sum to 255
+class QuantizedMesh{
+	public:
+		QuantizedMesh();
+		int numVertices;
+		float positionOffset[3]; // position = positionOffset + value * positionScale
+		float positionScale[3];
+		std::vector<unsigned short> positions; // 3 per vertex
+		std::vector<signed char> normals; // 2 per vertex
+		float uvOffset[2];
+		float uvScale[2];
+		std::vector<unsigned short> uvs; // 2 per vertex
+		std::vector<QuantizedUVSet> extraUVSets; // same order as GeometryData::extraUVSets
+		std::vector<signed char> tangents; // 2 per vertex
+		std::vector<unsigned char> colors; // 4 per vertex, clamped to [0, 1]
+		std::vector<unsigned char> jointIndices; // 4 per vertex
+		std::vector<unsigned short> jointIndices16; // used instead of jointIndices when jointIndexSize is 2
+		unsigned int jointIndexSize;
+		std::vector<unsigned char> weights; // 4 per vertex, unused influences have weight 0
+		int numIndices;
+		std::vector<unsigned char> indexData; // zigzag encoded difference to the next unused vertex as variable length integers
+		float maxPositionError; // measured maximum distance to the source positions
+		float maxNormalError; // measured maximum angle to the source normals in radians
+		float maxUVError; // measured maximum difference of a uv component, including the extra uv sets
+		float maxTangentError; // measured maximum angle to the source tangents in radians
+		float maxColorError; // measured maximum difference of a color channel after clamping
+		float maxWeightError; // measured maximum difference of a joint weight
+		size_t getNumBytes();
+		// write numVertices * 3, numVertices * 3 and numVertices * 2 floats
+		void decodePositions(float* out);
+		void decodeNormals(float* out);
+		void decodeUVs(float* out);
+		// write numVertices * 2, numVertices * 3 and numVertices * 4 floats
+		void decodeExtraUVs(int uvSet, float* out);
+		void decodeTangents(float* out);
+		void decodeColors(float* out);
+		// writes numVertices * 4 joint ids and weights, influences with weight 0 get id -1
+		void decodeJointWeights(int* jointIds, float* jointWeights);
+		// writes numIndices indices, returns false if the index data is corrupt
+		bool decodeIndices(unsigned int* out);
+};
+
+// encodes the vertices, normals, uvs, extra uv sets, tangents, colors, joint weights and indices of the mesh,
+// buffers that do not have one entry per vertex are left empty
+void quantizeMesh(GeometryData* geometry, QuantizedMesh* quantized);
+
+#endif //VERTEX_QUANTIZATION_H_
\ No newline at end of file
@@ -0,0 +1,38 @@
+# Compares the load time of the import profiles, e.g.
+# python benchmark_profiles.py --repeat 5 walk.fbx run.fbx
+import argparse
+import os
+import time
+import fbx_importer
+
+
+def time_profile(filenames, profile, repeat, options):
+    timings = list()
+    for _ in range(repeat):
+        start = time.perf_counter()
+        for filename in filenames:
+            fbx_importer.load_fbx_file(filename, profile=profile, **options)
+        timings.append(time.perf_counter() - start)
+    return min(timings)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load time of the import profiles")
+    parser.add_argument("filenames", nargs="+")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per profile, the fastest run is reported")
+    parser.add_argument("--profiles", nargs="+", default=["all", "animations", "skeleton", "meshes"])
+    parser.add_argument("--num_threads", type=int, default=0)
+    args = parser.parse_args()
+    filenames = [os.fsencode(filename) for filename in args.filenames]
+    options = {"num_threads": args.num_threads}
+    baseline = None
+    print("%-12s %10s %8s" % ("profile", "seconds", "speedup"))
+    for profile in args.profiles:
+        seconds = time_profile(filenames, profile, args.repeat, options)
+        if baseline is None:
+            baseline = seconds
+        print("%-12s %10.3f %7.2fx" % (profile, seconds, baseline / seconds))
+
+
+if __name__ == "__main__":
+    main()
@@ -23,17 +23,29 @@
 # distutils: language = c++
 
 from libcpp cimport bool
+import os
+import sys
+import weakref
+from collections import deque
+from concurrent.futures import ProcessPoolExecutor, wait, FIRST_COMPLETED
+from concurrent.futures.process import BrokenProcessPool
 import numpy as np
+cimport numpy as cnp
+cimport cython
 from libcpp.map cimport map
+from libcpp.utility cimport pair
 from libcpp.string cimport string
+from libc.string cimport memcpy
 from cython.operator cimport dereference as deref, preincrement as inc
 
+cnp.import_array()
+
 #cdef extern from "<string>" namespace "std":
 #    cdef cppclass string:
 #        string() except +
 
 
-cdef extern from "<vector>" namespace "std":
+cdef extern from "<vector>" namespace "std" nogil:
     cdef cppclass vector[T]:
         cppclass iterator:
             T operator*()
@@ -44,6 +56,7 @@ cdef extern from "<vector>" namespace "std":
         void push_back(T&)
         T& operator[](int)
         T& at(int)
+        T* data()
         iterator begin()
         iterator end()
         int size()
@@ -79,18 +92,28 @@ cdef extern from "joint.h":
         int index
         vec3 offset
         quat rotation
-        mat4 invBindPose
         vector[Joint*] children
 
 cdef extern from "joint_frames.h":
-    cdef struct JointFrames:
-        vector[vec3] localTranslation
-        vector[vec3] localEulerAngles
-        vector[string] channels
-        vector[quat] localQuaternions
+    cdef struct CurveKey:
+        float time
+        float value
+        float leftDerivative
+        float rightDerivative
+        int interpolation
 
-    cdef struct JointFramesMap:
-        map[string, JointFrames] frames
+    cdef struct JointCurves:
+        vector[CurveKey] channels[6]
+        int rotationOrder
+
+    cdef cppclass JointFramesMap:
+        int getNumTracks()
+        vector[string] jointNames
+        vector[int] jointIndices
+        int numFrames
+        vector[vec3] localTranslations
+        vector[quat] localQuaternions
+        map[string, JointCurves] curves
         float frameTime
 
 cdef extern from "skeleton.h":
@@ -98,6 +121,8 @@ cdef extern from "skeleton.h":
         Skeleton() except +
         map[string, Joint*] joints
         vector[string] jointOrder
+        vector[int] parentIndices
+        vector[mat4] inverseBindPoses
         double frameTime
         string root
 
@@ -131,15 +156,86 @@ cdef extern from "graphic_types.h":
         int IDs[4]
         float Weights[4]
 
+cdef extern from "animation_compression.h":
+    cdef cppclass CompressedJointFramesMap:
+        CompressedJointFramesMap() except +
+        vector[string] jointNames
+        int numFrames
+        float frameTime
+        float maxTranslationError
+        float maxRotationError
+        size_t getNumBytes()
+        void decompress(int firstFrame, int lastFrame, float* translations, float* quaternions) nogil
+
+cdef extern from "vertex_quantization.h":
+    cdef cppclass QuantizedUVSet:
+        float offset[2]
+        float scale[2]
+        vector[unsigned short] values
+
+    cdef cppclass QuantizedMesh:
+        QuantizedMesh() except +
+        int numVertices
+        float positionOffset[3]
+        float positionScale[3]
+        vector[unsigned short] positions
+        vector[signed char] normals
+        float uvOffset[2]
+        float uvScale[2]
+        vector[unsigned short] uvs
+        vector[QuantizedUVSet] extraUVSets
+        vector[signed char] tangents
+        vector[unsigned char] colors
+        vector[unsigned char] jointIndices
+        vector[unsigned short] jointIndices16
+        unsigned int jointIndexSize
+        vector[unsigned char] weights
+        int numIndices
+        float maxPositionError
+        float maxNormalError
+        float maxUVError
+        float maxTangentError
+        float maxColorError
+        float maxWeightError
+        size_t getNumBytes()
+        void decodePositions(float* out) nogil
+        void decodeNormals(float* out) nogil
+        void decodeUVs(float* out) nogil
+        void decodeExtraUVs(int uvSet, float* out) nogil
+        void decodeTangents(float* out) nogil
+        void decodeColors(float* out) nogil
+        void decodeJointWeights(int* jointIds, float* jointWeights) nogil
+        bool decodeIndices(unsigned int* out) nogil
+
 cdef extern from "geometry_data.h":
+    cdef struct MeshLod:
+        float ratio
+        float error
+        vector[unsigned int] indices
+
+    cdef struct VertexCacheStatistics:
+        float acmr
+        float atvr
+
     cdef cppclass GeometryData:
         GeometryData() except +
         vector[Vertex] vertices
         vector[Normal] normals
         vector[unsigned short] indices
+        vector[unsigned int] indices32
+        unsigned int indexSize
+        unsigned int getIndex(size_t i)
+        size_t getNumIndices()
         vector[Color] colors
         vector[UVCoord] uvs
+        vector[vector[UVCoord]] extraUVSets
+        vector[string] uvSetNames
+        vector[Normal] tangents
         vector[VertexJointData] jointWeights
+        vector[MeshLod] lods
+        VertexCacheStatistics originalCacheStatistics
+        VertexCacheStatistics optimizedCacheStatistics
+        QuantizedMesh* quantized
         string texturePath
         int nPolyVertices
         Skeleton skeleton
@@ -149,11 +245,62 @@ cdef extern from "geometry_data.h":
         vector[GeometryData*] meshList
         Skeleton* skeleton
         map[string, JointFramesMap] animations
+        map[string, CompressedJointFramesMap*] compressedAnimations
+        size_t getNumBytes()
+
+cdef extern from "load_options.h":
+    cdef cppclass LoadOptions:
+        LoadOptions() except +
+        bool weldVertices
+        int numThreads
+        bool extractKeyframes
+        double sampleRate
+        double startTime
+        double endTime
+        map[string, pair[double, double]] takeTimeRanges
+        bool compressAnimations
+        float translationErrorBound
+        float rotationErrorBound
+        string cacheDirectory
+        bool importSkeleton
+        bool importMeshes
+        bool importAnimations
+        vector[float] lodRatios
+        bool optimizeVertexOrder
+        bool quantizeVertices
+        bool keepQuads
+
+cdef extern from "skinning.h":
+    cdef struct SkinningInput:
+        int numVertices
+        const float* positions[3]
+        const float* normals[3]
+        const int* jointIndices[4]
+        const float* weights[4]
+    void skinVertices(const SkinningInput& input, const float* palette, float** outPositions, float** outNormals) nogil
+
+cdef extern from "forward_kinematics.h":
+    void computeGlobalTransformations(const int* parentIndices, int numJoints, int numFrames, const float* translations, const float* quaternions,
+                                      float* transformations, float* positions, int numThreads) nogil
+
+cdef extern from "geometry_data_cache.h":
+    string serializeCompressedAnimation(CompressedJointFramesMap* compressed)
+    bool deserializeCompressedAnimation(const string& data, CompressedJointFramesMap* compressed)
+    string serializeQuantizedMesh(QuantizedMesh* quantized)
+    bool deserializeQuantizedMesh(const string& data, QuantizedMesh* quantized)
 
 cdef extern from "fbx_geometry_loader.h":
     cdef cppclass FBXGeometryLoader:
         FBXGeometryLoader() except +
-        bool loadGeometryDataFromFile(const char* path, GeometryDataList* geometryDataList)
+        bool loadGeometryDataFromFile(const char* path, GeometryDataList* geometryDataList, const LoadOptions& options)
+        bool openFile(const char* path, const LoadOptions& options)
+        void closeFile()
+        void getTakeNames(vector[string]& takeNames)
+        bool getTakeDuration(const string& takeName, double& duration)
+        void getMeshNames(vector[string]& meshNames)
+        void extractSkeleton(GeometryDataList* geometryDataList)
+        void extractMeshes(GeometryDataList* geometryDataList)
+        bool extractTake(const string& takeName, double startTime, double endTime, const vector[string]& nodeNames, Skeleton* skeleton, JointFramesMap& animation) nogil
 
 
 cdef mat4_to_numpy(mat4& m):
@@ -162,7 +309,7 @@ cdef mat4_to_numpy(mat4& m):
                      [m[2][0], m[2][1], m[2][2], m[2][3]],
                      [m[3][0], m[3][1], m[3][2], m[3][3]]], dtype=np.float).T
 
-cdef convert_joint_to_dict(Joint* j):
+cdef convert_joint_to_dict(Joint* j, Skeleton* s):
     joint_dict = dict()
     if j.index == 0:
         joint_dict["node_type"] = 0 # root
@@ -179,7 +326,10 @@ cdef convert_joint_to_dict(Joint* j):
     joint_dict["fixed"] = False
     joint_dict["rotation"] = [j.rotation.w, j.rotation.x, j.rotation.y, j.rotation.z]
     joint_dict["offset"] = [j.offset.x, j.offset.y,j.offset.z]
-    joint_dict["inv_bind_pose"] = mat4_to_numpy(j.invBindPose)
+    if j.index >= 0:
+        joint_dict["inv_bind_pose"] = mat4_to_numpy(s.inverseBindPoses[j.index])
+    else:
+        joint_dict["inv_bind_pose"] = np.eye(4)
     joint_dict["children"] = list()
     n_children = j.children.size()
     for i in range(n_children):
@@ -196,15 +346,165 @@ cdef convert_skeleton_to_dict(GeometryDataList* data_list):
     cdef map[string, Joint*].iterator it = s.joints.begin()
     while it != s.joints.end():
         name = deref(it).second.name.decode("utf-8")
-        skeleton_dict["nodes"][name] = convert_joint_to_dict(deref(it).second)
+        skeleton_dict["nodes"][name] = convert_joint_to_dict(deref(it).second, s)
         inc(it)
     
     skeleton_dict["animated_joints"] = list()
     for i in range(s.jointOrder.size()):
         name = s.jointOrder.at(i).decode("utf-8")
         skeleton_dict["animated_joints"].append(name)
+    skeleton_dict["parent_indices"] = [s.parentIndices[i] for i in range(s.parentIndices.size())]
     return skeleton_dict
 
+cdef class QuantizedVertices:
+    # compact vertex and index buffers of a mesh that are decoded on demand
+    cdef QuantizedMesh* mesh
+    cdef object __weakref__
+
+    def __dealloc__(self):
+        if self.mesh != NULL:
+            del self.mesh
+            self.mesh = NULL
+
+    def __reduce__(self):
+        # pickled as the serialized buffers so that results can be returned from worker processes
+        return (_restore_quantized_vertices, (serializeQuantizedMesh(self.mesh),))
+
+    @property
+    def n_vertices(self):
+        return self.mesh.numVertices
+
+    @property
+    def n_indices(self):
+        return self.mesh.numIndices
+
+    @property
+    def nbytes(self):
+        return self.mesh.getNumBytes()
+
+    @property
+    def max_position_error(self):
+        return self.mesh.maxPositionError
+
+    @property
+    def max_normal_error(self):
+        return self.mesh.maxNormalError
+
+    @property
+    def max_uv_error(self):
+        return self.mesh.maxUVError
+
+    @property
+    def max_tangent_error(self):
+        return self.mesh.maxTangentError
+
+    @property
+    def max_color_error(self):
+        return self.mesh.maxColorError
+
+    @property
+    def max_weight_error(self):
+        return self.mesh.maxWeightError
+
+    @property
+    def buffers(self):
+        # copies of the quantized arrays with their ranges, e.g. to upload them without decoding
+        cdef QuantizedMesh* m = self.mesh
+        cdef QuantizedUVSet* uv_set
+        buffers = dict()
+        buffers["positions"] = copy_buffer(m.positions.data(), m.positions.size() // 3, 3, cnp.NPY_UINT16)
+        buffers["position_offset"] = [m.positionOffset[k] for k in range(3)]
+        buffers["position_scale"] = [m.positionScale[k] for k in range(3)]
+        buffers["normals"] = copy_buffer(m.normals.data(), m.normals.size() // 2, 2, cnp.NPY_INT8)
+        buffers["texture_coordinates"] = copy_buffer(m.uvs.data(), m.uvs.size() // 2, 2, cnp.NPY_UINT16)
+        buffers["uv_offset"] = [m.uvOffset[k] for k in range(2)]
+        buffers["uv_scale"] = [m.uvScale[k] for k in range(2)]
+        buffers["uv_sets"] = list()
+        for i in range(m.extraUVSets.size()):
+            uv_set = &m.extraUVSets[i]
+            buffers["uv_sets"].append({"values": copy_buffer(uv_set.values.data(), uv_set.values.size() // 2, 2, cnp.NPY_UINT16),
+                                       "offset": [uv_set.offset[k] for k in range(2)], "scale": [uv_set.scale[k] for k in range(2)]})
+        buffers["tangents"] = copy_buffer(m.tangents.data(), m.tangents.size() // 2, 2, cnp.NPY_INT8)
+        buffers["colors"] = copy_buffer(m.colors.data(), m.colors.size() // 4, 4, cnp.NPY_UINT8)
+        if m.jointIndexSize == 2:
+            buffers["joint_indices"] = copy_buffer(m.jointIndices16.data(), m.jointIndices16.size() // 4, 4, cnp.NPY_UINT16)
+        else:
+            buffers["joint_indices"] = copy_buffer(m.jointIndices.data(), m.jointIndices.size() // 4, 4, cnp.NPY_UINT8)
+        buffers["weights"] = copy_buffer(m.weights.data(), m.weights.size() // 4, 4, cnp.NPY_UINT8)
+        return buffers
+
+    def decode(self):
+        # float buffers and uint32 indices with the layout of the NumPy export
+        cdef QuantizedMesh* m = self.mesh
+        cdef int n = m.numVertices
+        vertices = np.zeros((n, 3), dtype=np.float32)
+        normals = np.zeros((n, 3), dtype=np.float32) if m.normals.size() > 0 else np.zeros((0, 3), dtype=np.float32)
+        uvs = np.zeros((n, 2), dtype=np.float32) if m.uvs.size() > 0 else np.zeros((0, 2), dtype=np.float32)
+        tangents = np.zeros((n, 3), dtype=np.float32) if m.tangents.size() > 0 else np.zeros((0, 3), dtype=np.float32)
+        colors = np.zeros((n, 4), dtype=np.float32) if m.colors.size() > 0 else np.zeros((0, 4), dtype=np.float32)
+        n_weights = n if m.weights.size() > 0 else 0
+        joint_ids = np.full((n_weights, 4), -1, dtype=np.int32)
+        weights = np.zeros((n_weights, 4), dtype=np.float32)
+        indices = np.zeros(m.numIndices, dtype=np.uint32)
+        cdef float* vertices_ptr = <float*>cnp.PyArray_DATA(vertices)
+        cdef float* normals_ptr = <float*>cnp.PyArray_DATA(normals)
+        cdef float* uvs_ptr = <float*>cnp.PyArray_DATA(uvs)
+        cdef float* tangents_ptr = <float*>cnp.PyArray_DATA(tangents)
+        cdef float* colors_ptr = <float*>cnp.PyArray_DATA(colors)
+        cdef float* uv_set_ptr
+        cdef int* joint_ids_ptr = <int*>cnp.PyArray_DATA(joint_ids)
+        cdef float* weights_ptr = <float*>cnp.PyArray_DATA(weights)
+        cdef unsigned int* indices_ptr = <unsigned int*>cnp.PyArray_DATA(indices)
+        cdef bool valid
+        with nogil:
+            m.decodePositions(vertices_ptr)
+            m.decodeNormals(normals_ptr)
+            m.decodeUVs(uvs_ptr)
+            m.decodeTangents(tangents_ptr)
+            m.decodeColors(colors_ptr)
+            m.decodeJointWeights(joint_ids_ptr, weights_ptr)
+            valid = m.decodeIndices(indices_ptr)
+        if not valid:
+            raise ValueError("Invalid quantized index data")
+        uv_sets = list()
+        for i in range(m.extraUVSets.size()):
+            uv_set = np.zeros((n, 2), dtype=np.float32) if m.extraUVSets[i].values.size() > 0 else np.zeros((0, 2), dtype=np.float32)
+            uv_set_ptr = <float*>cnp.PyArray_DATA(uv_set)
+            m.decodeExtraUVs(i, uv_set_ptr)
+            uv_sets.append(uv_set)
+        np.negative(normals, out=normals)
+        return {"vertices": vertices, "normals": normals, "texture_coordinates": uvs, "uv_sets": uv_sets,
+                "tangents": tangents, "colors": colors, "weights": (joint_ids, weights), "indices": indices}
+
+def _restore_quantized_vertices(bytes data):
+    cdef QuantizedVertices quantized = QuantizedVertices()
+    quantized.mesh = new QuantizedMesh()
+    if not deserializeQuantizedMesh(data, quantized.mesh):
+        raise ValueError("Invalid quantized mesh data")
+    return quantized
+
+cdef copy_buffer(void* ptr, int rows, int cols, int typenum):
+    cdef cnp.npy_intp shape[2]
+    shape[0] = rows
+    shape[1] = cols
+    return cnp.PyArray_SimpleNewFromData(2, shape, typenum, ptr).copy()
+
+cdef take_quantized_mesh(GeometryData* data):
+    # the Python object takes ownership of the quantized buffers
+    if data.quantized == NULL:
+        return None
+    cdef QuantizedVertices quantized = QuantizedVertices()
+    quantized.mesh = data.quantized
+    data.quantized = NULL
+    return quantized
+
+cdef convert_vertex_cache_statistics(GeometryData* data):
+    # only meshes that were optimized have statistics
+    if data.originalCacheStatistics.acmr == 0:
+        return None
+    return {"acmr_before": data.originalCacheStatistics.acmr, "atvr_before": data.originalCacheStatistics.atvr,
+            "acmr": data.optimizedCacheStatistics.acmr, "atvr": data.optimizedCacheStatistics.atvr}
+
 cdef convert_mesh_data_to_dict(GeometryData*& data):
     mesh_data = dict()
     mesh_data["texture"] = data.texturePath
@@ -213,8 +513,8 @@ cdef convert_mesh_data_to_dict(GeometryData*& data):
     else:
         mesh_data["type"] = "triangles"
     mesh_data["indices"] = list()
-    for j in range(data.indices.size()):
-        idx = data.indices.at(j)
+    for j in range(data.getNumIndices()):
+        idx = data.getIndex(j)
         mesh_data["indices"].append(idx)
 
     mesh_data["vertices"] = list()
@@ -245,65 +545,774 @@ cdef convert_mesh_data_to_dict(GeometryData*& data):
         a = data.colors.at(j).a
         mesh_data["colors"].append([r,g,b,a])
 
+    mesh_data["uv_set_names"] = data.uvSetNames
+    mesh_data["uv_sets"] = list()
+    for k in range(data.extraUVSets.size()):
+        mesh_data["uv_sets"].append([[data.extraUVSets[k][j].u, data.extraUVSets[k][j].v] for j in range(data.extraUVSets[k].size())])
+
+    mesh_data["tangents"] = list()
+    for j in range(data.tangents.size()):
+        mesh_data["tangents"].append([data.tangents.at(j).x, data.tangents.at(j).y, data.tangents.at(j).z])
+
     mesh_data["weights"] = list()
     for j in range(data.jointWeights.size()):
         entry = ([data.jointWeights.at(j).IDs[0], data.jointWeights.at(j).IDs[1], data.jointWeights.at(j).IDs[2], data.jointWeights.at(j).IDs[3]],
                   [data.jointWeights.at(j).Weights[0], data.jointWeights.at(j).Weights[1], data.jointWeights.at(j).Weights[2], data.jointWeights.at(j).Weights[3]] )
         mesh_data["weights"].append(entry)
+    mesh_data["lods"] = list()
+    for j in range(data.lods.size()):
+        mesh_data["lods"].append({"ratio": data.lods[j].ratio, "error": data.lods[j].error, "indices": data.lods[j].indices})
+    mesh_data["vertex_cache"] = convert_vertex_cache_statistics(data)
+    mesh_data["quantized"] = take_quantized_mesh(data)
+    return mesh_data
+
+cdef class GeometryDataOwner:
+    # keeps the C++ results alive as long as NumPy views on their storage exist
+    cdef GeometryDataList* data_list
+    cdef object __weakref__
+
+    @property
+    def nbytes(self):
+        if self.data_list == NULL:
+            return 0
+        return self.data_list.getNumBytes()
+
+    def __dealloc__(self):
+        if self.data_list != NULL:
+            del self.data_list
+            self.data_list = NULL
+
+cdef wrap_buffer(void* ptr, int rows, int cols, int typenum, GeometryDataOwner owner):
+    cdef cnp.npy_intp shape[2]
+    shape[0] = rows
+    shape[1] = cols
+    cdef cnp.ndarray arr = cnp.PyArray_SimpleNewFromData(2, shape, typenum, ptr)
+    cnp.set_array_base(arr, owner)
+    return arr
+
+cdef convert_mesh_data_to_arrays(GeometryData* data, GeometryDataOwner owner):
+    mesh_data = dict()
+    mesh_data["texture"] = data.texturePath
+    if data.nPolyVertices == 4:
+        mesh_data["type"] = "quads"
+    else:
+        mesh_data["type"] = "triangles"
+    if data.indexSize == 4:
+        mesh_data["indices"] = wrap_buffer(data.indices32.data(), data.indices32.size(), 1, cnp.NPY_UINT32, owner).reshape(-1)
+    else:
+        mesh_data["indices"] = wrap_buffer(data.indices.data(), data.indices.size(), 1, cnp.NPY_UINT16, owner).reshape(-1)
+    mesh_data["vertices"] = wrap_buffer(data.vertices.data(), data.vertices.size(), 3, cnp.NPY_FLOAT32, owner)
+    normals = wrap_buffer(data.normals.data(), data.normals.size(), 3, cnp.NPY_FLOAT32, owner)
+    np.negative(normals, out=normals)
+    mesh_data["normals"] = normals
+    mesh_data["texture_coordinates"] = wrap_buffer(data.uvs.data(), data.uvs.size(), 2, cnp.NPY_FLOAT32, owner)
+    mesh_data["colors"] = wrap_buffer(data.colors.data(), data.colors.size(), 4, cnp.NPY_FLOAT32, owner)
+    mesh_data["uv_set_names"] = data.uvSetNames
+    mesh_data["uv_sets"] = [wrap_buffer(data.extraUVSets[k].data(), data.extraUVSets[k].size(), 2, cnp.NPY_FLOAT32, owner) for k in range(data.extraUVSets.size())]
+    mesh_data["tangents"] = wrap_buffer(data.tangents.data(), data.tangents.size(), 3, cnp.NPY_FLOAT32, owner)
+    # VertexJointData interleaves 4 int ids and 4 float weights
+    joint_data = wrap_buffer(data.jointWeights.data(), data.jointWeights.size(), 8, cnp.NPY_INT32, owner)
+    mesh_data["weights"] = (joint_data[:, :4], joint_data[:, 4:].view(np.float32))
+    mesh_data["lods"] = list()
+    for j in range(data.lods.size()):
+        indices = wrap_buffer(data.lods[j].indices.data(), data.lods[j].indices.size(), 1, cnp.NPY_UINT32, owner).reshape(-1)
+        mesh_data["lods"].append({"ratio": data.lods[j].ratio, "error": data.lods[j].error, "indices": indices})
+    mesh_data["vertex_cache"] = convert_vertex_cache_statistics(data)
+    mesh_data["quantized"] = take_quantized_mesh(data)
     return mesh_data
 
-cdef convert_joint_frames_to_list(JointFrames& joinFrames):
+cdef convert_joint_frames_to_list(JointFramesMap& jointFramesMap, int track):
     frames = list()
-    for i in range(joinFrames.localTranslation.size()):
+    cdef int n_tracks = jointFramesMap.getNumTracks()
+    cdef size_t offset
+    for i in range(jointFramesMap.numFrames):
+        offset = i * n_tracks + track
         frame = dict()
-        tx = joinFrames.localTranslation[i].x
-        ty = joinFrames.localTranslation[i].y
-        tz = joinFrames.localTranslation[i].z
+        tx = jointFramesMap.localTranslations[offset].x
+        ty = jointFramesMap.localTranslations[offset].y
+        tz = jointFramesMap.localTranslations[offset].z
         frame["local_translation"] = [tx, ty, tz]
-        qx = joinFrames.localQuaternions[i].x
-        qy = joinFrames.localQuaternions[i].y
-        qz = joinFrames.localQuaternions[i].z
-        qw = joinFrames.localQuaternions[i].w
+        qx = jointFramesMap.localQuaternions[offset].x
+        qy = jointFramesMap.localQuaternions[offset].y
+        qz = jointFramesMap.localQuaternions[offset].z
+        qw = jointFramesMap.localQuaternions[offset].w
         frame["local_rotation"] = [qw, qx, qy, qz]
         frames.append(frame)
     return frames
 
+CURVE_KEY_DTYPE = np.dtype([("time", np.float32), ("value", np.float32), ("left_derivative", np.float32),
+                            ("right_derivative", np.float32), ("interpolation", np.int32)])
+CURVE_CHANNELS = ["Xposition", "Yposition", "Zposition", "Xrotation", "Yrotation", "Zrotation"]
+
+cdef convert_curve_keys_to_array(vector[CurveKey]& keys):
+    cdef cnp.ndarray keys_array = np.empty(keys.size(), dtype=CURVE_KEY_DTYPE)
+    if keys.size() > 0:
+        memcpy(cnp.PyArray_DATA(keys_array), keys.data(), keys.size() * sizeof(CurveKey))
+    return keys_array
+
+cdef convert_joint_curves_to_dict(JointFramesMap& jointFramesMap):
+    # curve keys of the joints that were not sampled, rotations are euler angles in degrees
+    keyframes = dict()
+    cdef map[string, JointCurves].iterator it = jointFramesMap.curves.begin()
+    while it != jointFramesMap.curves.end():
+        name = deref(it).first.decode("utf-8")
+        keyframes[name] = dict()
+        keyframes[name]["rotation_order"] = deref(it).second.rotationOrder
+        for i in range(6):
+            keyframes[name][CURVE_CHANNELS[i]] = convert_curve_keys_to_array(deref(it).second.channels[i])
+        inc(it)
+    return keyframes
+
 cdef convert_animation_to_dict(JointFramesMap& jointFramesMap):
     animation = dict()
     animation["curves"] = dict()
     animation["frame_time"] = jointFramesMap.frameTime
-    cdef map[string, JointFrames].iterator it = jointFramesMap.frames.begin()
-    while it != jointFramesMap.frames.end():
-        name = deref(it).first.decode("utf-8")
-        animation["curves"][name] = convert_joint_frames_to_list(deref(it).second)
-        inc(it)
+    animation["keyframes"] = convert_joint_curves_to_dict(jointFramesMap)
+    for j in range(jointFramesMap.getNumTracks()):
+        name = jointFramesMap.jointNames[j].decode("utf-8")
+        animation["curves"][name] = convert_joint_frames_to_list(jointFramesMap, j)
     return animation
 
-cdef convert_mesh_data_list_to_dict(GeometryDataList* data_list):
+@cython.boundscheck(False)
+@cython.wraparound(False)
+cdef convert_animation_to_arrays(JointFramesMap& jointFramesMap):
+    # dense (frames, joints, 3) translations and (frames, joints, 4) wxyz quaternions
+    cdef int n_joints = jointFramesMap.getNumTracks()
+    cdef int n_frames = jointFramesMap.numFrames
+    joint_names = [jointFramesMap.jointNames[j].decode("utf-8") for j in range(n_joints)]
+    translations = np.empty((n_frames, n_joints, 3), dtype=np.float32)
+    rotations = np.empty((n_frames, n_joints, 4), dtype=np.float32)
+    cdef float[:, :, ::1] t = translations
+    cdef float[:, :, ::1] q = rotations
+    cdef vec3* src_t = jointFramesMap.localTranslations.data()
+    cdef quat* src_q = jointFramesMap.localQuaternions.data()
+    cdef int i, j
+    with nogil:
+        for i in range(n_frames):
+            for j in range(n_joints):
+                t[i, j, 0] = src_t.x
+                t[i, j, 1] = src_t.y
+                t[i, j, 2] = src_t.z
+                q[i, j, 0] = src_q.w
+                q[i, j, 1] = src_q.x
+                q[i, j, 2] = src_q.y
+                q[i, j, 3] = src_q.z
+                src_t += 1
+                src_q += 1
+    animation = dict()
+    animation["frame_time"] = jointFramesMap.frameTime
+    animation["joint_names"] = joint_names
+    animation["translations"] = translations
+    animation["rotations"] = rotations
+    animation["keyframes"] = convert_joint_curves_to_dict(jointFramesMap)
+    return animation
+
+cdef class CompressedAnimation:
+    # key reduced frames with quantized rotations that are decompressed on demand
+    cdef CompressedJointFramesMap* animation
+    cdef object __weakref__
+
+    def __dealloc__(self):
+        if self.animation != NULL:
+            del self.animation
+            self.animation = NULL
+
+    def __reduce__(self):
+        # pickled as the serialized tracks so that results can be returned from worker processes
+        return (_restore_compressed_animation, (serializeCompressedAnimation(self.animation),))
+
+    @property
+    def joint_names(self):
+        return [self.animation.jointNames[j].decode("utf-8") for j in range(self.animation.jointNames.size())]
+
+    @property
+    def n_frames(self):
+        return self.animation.numFrames
+
+    @property
+    def frame_time(self):
+        return self.animation.frameTime
+
+    @property
+    def nbytes(self):
+        return self.animation.getNumBytes()
+
+    @property
+    def max_translation_error(self):
+        return self.animation.maxTranslationError
+
+    @property
+    def max_rotation_error(self):
+        return self.animation.maxRotationError
+
+    def decompress(self, start=0, end=None):
+        # (frames, joints, 3) translations and (frames, joints, 4) wxyz quaternions of the frames [start, end)
+        cdef int first_frame = max(0, min(start, self.animation.numFrames))
+        cdef int last_frame = self.animation.numFrames if end is None else max(first_frame, min(end, self.animation.numFrames))
+        cdef int n_joints = self.animation.jointNames.size()
+        translations = np.empty((last_frame - first_frame, n_joints, 3), dtype=np.float32)
+        rotations = np.empty((last_frame - first_frame, n_joints, 4), dtype=np.float32)
+        if last_frame > first_frame and n_joints > 0:
+            self._decompress(first_frame, last_frame, translations, rotations)
+        return translations, rotations
+
+    @cython.boundscheck(False)
+    @cython.wraparound(False)
+    cdef _decompress(self, int first_frame, int last_frame, float[:, :, ::1] t, float[:, :, ::1] q):
+        with nogil:
+            self.animation.decompress(first_frame, last_frame, &t[0, 0, 0], &q[0, 0, 0])
+
+def _restore_compressed_animation(bytes data):
+    cdef CompressedAnimation compressed = CompressedAnimation()
+    compressed.animation = new CompressedJointFramesMap()
+    if not deserializeCompressedAnimation(data, compressed.animation):
+        raise ValueError("Invalid compressed animation data")
+    return compressed
+
+cdef convert_mesh_data_list_to_dict(GeometryDataList* data_list, GeometryDataOwner owner=None):
     mesh_data = dict()
     mesh_list = list()
     for i in range(data_list.meshList.size()):
-        mesh = convert_mesh_data_to_dict(data_list.meshList.at(i))
+        if owner is not None:
+            mesh = convert_mesh_data_to_arrays(data_list.meshList.at(i), owner)
+        else:
+            mesh = convert_mesh_data_to_dict(data_list.meshList.at(i))
         mesh_list.append(mesh)
     
-    mesh_data["skeleton"] = convert_skeleton_to_dict(data_list)
+    mesh_data["skeleton"] = None
+    if data_list.skeleton != NULL:
+        mesh_data["skeleton"] = convert_skeleton_to_dict(data_list)
     mesh_data["mesh_list"] = mesh_list
     print("mesh_list", len(mesh_list), data_list.meshList.size())
     mesh_data["animations"] = dict()
     cdef map[string, JointFramesMap].iterator it = data_list.animations.begin()
     while it != data_list.animations.end():
         name = deref(it).first.decode("utf-8")
-        if deref(it).second.frames.size() > 0:
-            mesh_data["animations"][name] = convert_animation_to_dict(deref(it).second)
+        if deref(it).second.getNumTracks() > 0 or deref(it).second.curves.size() > 0:
+            if owner is not None:
+                mesh_data["animations"][name] = convert_animation_to_arrays(deref(it).second)
+            else:
+                mesh_data["animations"][name] = convert_animation_to_dict(deref(it).second)
         inc(it)
+    # the Python objects take ownership of the compressed takes
+    cdef CompressedAnimation compressed
+    cdef map[string, CompressedJointFramesMap*].iterator compressed_it = data_list.compressedAnimations.begin()
+    while compressed_it != data_list.compressedAnimations.end():
+        if deref(compressed_it).second != NULL:
+            name = deref(compressed_it).first.decode("utf-8")
+            compressed = CompressedAnimation()
+            compressed.animation = deref(compressed_it).second
+            data_list.compressedAnimations[deref(compressed_it).first] = NULL
+            animation = mesh_data["animations"].setdefault(name, {"frame_time": compressed.frame_time, "keyframes": dict()})
+            animation["compressed"] = compressed
+        inc(compressed_it)
     return mesh_data
 
-def load_fbx_file(filename):
+# imported (skeleton, meshes, animations) of the load profiles
+IMPORT_PROFILES = {"all": (True, True, True), "skeleton": (True, False, False),
+                   "meshes": (False, True, False), "animations": (True, False, True)}
+
+cdef LoadOptions convert_dict_to_load_options(options) except *:
+    cdef LoadOptions load_options
+    # the profile sets the defaults of the import_* options
+    options = dict(options)
+    profile = options.pop("profile", "all")
+    if profile not in IMPORT_PROFILES:
+        raise ValueError("Unknown load profile " + str(profile))
+    load_options.importSkeleton, load_options.importMeshes, load_options.importAnimations = IMPORT_PROFILES[profile]
+    for key, value in options.items():
+        if key == "weld_vertices":
+            load_options.weldVertices = value
+        elif key == "num_threads":
+            load_options.numThreads = value
+        elif key == "extract_keyframes":
+            load_options.extractKeyframes = value
+        elif key == "sample_rate":
+            load_options.sampleRate = value
+        elif key == "start_time":
+            load_options.startTime = value
+        elif key == "end_time":
+            load_options.endTime = value
+        elif key == "time_ranges":
+            for take_name, time_range in value.items():
+                load_options.takeTimeRanges[take_name.encode("utf-8")] = pair[double, double](time_range[0], time_range[1])
+        elif key == "compress_animations":
+            load_options.compressAnimations = value
+        elif key == "translation_error":
+            load_options.translationErrorBound = value
+        elif key == "rotation_error":
+            load_options.rotationErrorBound = value
+        elif key == "cache_directory":
+            os.makedirs(value, exist_ok=True)
+            load_options.cacheDirectory = value.encode("utf-8")
+        elif key == "import_skeleton":
+            load_options.importSkeleton = value
+        elif key == "import_meshes":
+            load_options.importMeshes = value
+        elif key == "import_animations":
+            load_options.importAnimations = value
+        elif key == "optimize_vertex_order":
+            load_options.optimizeVertexOrder = value
+        elif key == "keep_quads":
+            load_options.keepQuads = value
+        elif key == "quantize_vertices":
+            load_options.quantizeVertices = value
+        elif key == "lod_ratios":
+            for ratio in value:
+                load_options.lodRatios.push_back(ratio)
+        else:
+            raise ValueError("Unknown load option " + key)
+    return load_options
+
+cdef check_component_array(array, int n_rows, int n_vertices, dtype, name):
+    if array.shape != (n_rows, n_vertices) or array.dtype != dtype or not array.flags.c_contiguous:
+        raise ValueError("%s must be a C contiguous %s array with shape (%d, %d)" % (name, np.dtype(dtype).name, n_rows, n_vertices))
+    return array
+
+cdef class SkinningMesh:
+    # bind pose vertices and joint weights in structure of arrays layout for repeated linear blend skinning,
+    # e.g. SkinningMesh(mesh["vertices"], *mesh["weights"], normals=mesh["normals"]) for a mesh loaded with use_numpy
+    cdef readonly object positions
+    cdef readonly object normals
+    cdef readonly object joint_ids
+    cdef readonly object weights
+    cdef readonly int n_vertices
+    cdef readonly int max_joint_id
+
+    def __init__(self, vertices, joint_ids, weights, normals=None):
+        vertices = np.asarray(vertices, dtype=np.float32).reshape(-1, 3)
+        self.n_vertices = vertices.shape[0]
+        joint_ids = np.asarray(joint_ids, dtype=np.int32).reshape(self.n_vertices, 4)
+        weights = np.asarray(weights, dtype=np.float32).reshape(self.n_vertices, 4)
+        # unused influences are stored with id -1 and must not be looked up in the palette
+        invalid = joint_ids < 0
+        self.positions = np.ascontiguousarray(vertices.T)
+        self.joint_ids = np.ascontiguousarray(np.where(invalid, 0, joint_ids).T.astype(np.int32))
+        self.weights = np.ascontiguousarray(np.where(invalid, 0, weights).T.astype(np.float32))
+        self.normals = None
+        if normals is not None:
+            self.normals = np.ascontiguousarray(np.asarray(normals, dtype=np.float32).reshape(self.n_vertices, 3).T)
+        self.max_joint_id = self.joint_ids.max() if self.n_vertices > 0 else -1
+
+    def skin(self, skinning_matrices, out_positions=None, out_normals=None):
+        # skinning_matrices has shape (n_joints, 4, 4) with the global transformation times the inverse bind pose
+        # of each joint id, returns the positions and the normalized normals as (3, n_vertices) arrays,
+        # the transposed arrays are (n_vertices, 3) views
+        matrices = np.asarray(skinning_matrices, dtype=np.float32)
+        if matrices.ndim != 3 or matrices.shape[1:] != (4, 4):
+            raise ValueError("skinning_matrices must have shape (n_joints, 4, 4)")
+        if matrices.shape[0] <= self.max_joint_id:
+            raise ValueError("skinning_matrices has %d matrices but joint id %d is used" % (matrices.shape[0], self.max_joint_id))
+        # the kernel expects column major matrices
+        palette = np.ascontiguousarray(matrices.transpose(0, 2, 1))
+        if out_positions is None:
+            out_positions = np.empty((3, self.n_vertices), dtype=np.float32)
+        check_component_array(out_positions, 3, self.n_vertices, np.float32, "out_positions")
+        if self.normals is not None:
+            if out_normals is None:
+                out_normals = np.empty((3, self.n_vertices), dtype=np.float32)
+            check_component_array(out_normals, 3, self.n_vertices, np.float32, "out_normals")
+        else:
+            out_normals = None
+        if self.n_vertices > 0:
+            self._skin(palette, out_positions, out_normals)
+        return out_positions, out_normals
+
+    @cython.boundscheck(False)
+    @cython.wraparound(False)
+    cdef _skin(self, float[:, :, ::1] palette, float[:, ::1] out_positions, out_normals):
+        cdef SkinningInput skinning_input
+        cdef float[:, ::1] positions = self.positions
+        cdef int[:, ::1] joint_ids = self.joint_ids
+        cdef float[:, ::1] weights = self.weights
+        cdef float[:, ::1] normals
+        cdef float[:, ::1] normals_view
+        cdef float* position_ptrs[3]
+        cdef float* normal_ptrs[3]
+        cdef float** normal_output = NULL
+        cdef int c
+        skinning_input.numVertices = self.n_vertices
+        for c in range(3):
+            skinning_input.positions[c] = &positions[c, 0]
+            skinning_input.normals[c] = NULL
+            position_ptrs[c] = &out_positions[c, 0]
+        for c in range(4):
+            skinning_input.jointIndices[c] = &joint_ids[c, 0]
+            skinning_input.weights[c] = &weights[c, 0]
+        if out_normals is not None:
+            normals = self.normals
+            normals_view = out_normals
+            for c in range(3):
+                skinning_input.normals[c] = &normals[c, 0]
+                normal_ptrs[c] = &normals_view[c, 0]
+            normal_output = normal_ptrs
+        with nogil:
+            skinVertices(skinning_input, &palette[0, 0, 0], position_ptrs, normal_output)
+
+def get_local_transforms(skeleton, animation):
+    # (n_frames, n_joints, 3) translations and (n_frames, n_joints, 4) wxyz rotations of the animated joints of a skeleton dict,
+    # joints without frames in the animation keep their offset and rotation
+    keyframes = animation.get("keyframes", dict())
+    keyed_joints = [str(name) for name in skeleton["animated_joints"] if name in keyframes]
+    if len(keyed_joints) > 0:
+        # the curve keys are not sampled here, these joints would silently keep their offset and rotation
+        raise ValueError("joints %s are stored as keyframes, load the file without extract_keyframes" % ", ".join(keyed_joints))
+    if "compressed" in animation:
+        names = animation["compressed"].joint_names
+        translations, rotations = animation["compressed"].decompress()
+    elif "translations" in animation:
+        names = animation["joint_names"]
+        translations, rotations = animation["translations"], animation["rotations"]
+    else:
+        names = list(animation["curves"].keys())
+        n_frames = max([len(frames) for frames in animation["curves"].values()] + [0])
+        translations = np.zeros((n_frames, len(names), 3), dtype=np.float32)
+        rotations = np.zeros((n_frames, len(names), 4), dtype=np.float32)
+        rotations[:, :, 0] = 1
+        for k, name in enumerate(names):
+            frames = animation["curves"][name]
+            if len(frames) > 0:
+                translations[:len(frames), k] = [frame["local_translation"] for frame in frames]
+                rotations[:len(frames), k] = [frame["local_rotation"] for frame in frames]
+    joint_names = skeleton["animated_joints"]
+    nodes = skeleton["nodes"]
+    n_frames = translations.shape[0]
+    local_translations = np.empty((n_frames, len(joint_names), 3), dtype=np.float32)
+    local_rotations = np.empty((n_frames, len(joint_names), 4), dtype=np.float32)
+    if len(joint_names) > 0:
+        local_translations[:] = [nodes[name]["offset"] for name in joint_names]
+        local_rotations[:] = [nodes[name]["rotation"] for name in joint_names]
+    joint_indices = dict((name, j) for j, name in enumerate(joint_names))
+    src = [k for k, name in enumerate(names) if name in joint_indices]
+    dst = [joint_indices[names[k]] for k in src]
+    local_translations[:, dst] = translations[:, src]
+    local_rotations[:, dst] = rotations[:, src]
+    return local_translations, local_rotations
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def compute_global_transforms(skeleton, animation, positions_only=False, num_threads=0):
+    # global transformations of the animated joints of a skeleton dict for all frames of an animation dict as
+    # (n_frames, n_joints, 4, 4) matrices with the translation in [:3, 3] or (n_frames, n_joints, 3) positions
+    translations, rotations = get_local_transforms(skeleton, animation)
+    cdef int[::1] parents = np.ascontiguousarray(skeleton["parent_indices"], dtype=np.int32)
+    cdef float[:, :, ::1] t = translations
+    cdef float[:, :, ::1] q = rotations
+    cdef int n_frames = translations.shape[0]
+    cdef int n_joints = translations.shape[1]
+    cdef int n_threads = num_threads
+    if parents.shape[0] != n_joints:
+        raise ValueError("parent_indices must have one entry per animated joint")
+    # the kernel reads the transformation of each parent without checks, so it has to be computed before
+    cdef int j
+    for j in range(n_joints):
+        if parents[j] < -1 or parents[j] >= j:
+            raise ValueError("parent_indices[%d] is %d, it must be -1 or the index of an earlier joint" % (j, parents[j]))
+    cdef cnp.ndarray result
+    cdef float* transformations = NULL
+    cdef float* positions = NULL
+    if positions_only:
+        result = np.empty((n_frames, n_joints, 3), dtype=np.float32)
+        positions = <float*>cnp.PyArray_DATA(result)
+    else:
+        # column major matrices, the last two axes are swapped on return
+        result = np.empty((n_frames, n_joints, 4, 4), dtype=np.float32)
+        transformations = <float*>cnp.PyArray_DATA(result)
+    if n_frames > 0 and n_joints > 0:
+        with nogil:
+            computeGlobalTransformations(&parents[0], n_joints, n_frames, &t[0, 0, 0], &q[0, 0, 0], transformations, positions, n_threads)
+    if positions_only:
+        return result
+    return result.swapaxes(2, 3)
+
+cdef load_with_loader(FBXGeometryLoader* loader, filename, use_numpy, options, retained=None):
+    # converts the results of one file and frees them unless NumPy views keep them alive,
+    # objects that still own C++ memory afterwards are added to the retained set
     cdef char* f = filename
+    cdef LoadOptions load_options = convert_dict_to_load_options(options)
     cdef GeometryDataList* data = new GeometryDataList()
+    cdef GeometryDataOwner owner = None
+    result = None
+    try:
+        if loader.loadGeometryDataFromFile(f, data, load_options):
+            if use_numpy:
+                owner = GeometryDataOwner()
+                owner.data_list = data
+                data = NULL
+                result = convert_mesh_data_list_to_dict(owner.data_list, owner)
+            else:
+                result = convert_mesh_data_list_to_dict(data)
+    finally:
+        if data != NULL:
+            del data
+    if retained is not None and result is not None:
+        if owner is not None:
+            retained.add(owner)
+        for animation in result["animations"].values():
+            if "compressed" in animation:
+                retained.add(animation["compressed"])
+        for mesh in result["mesh_list"]:
+            if mesh["quantized"] is not None:
+                retained.add(mesh["quantized"])
+    return result
+
+def load_fbx_file(filename, use_numpy=False, **options):
+    # with use_numpy the mesh buffers are returned as NumPy views on the C++ storage
+    # and each animation as dense translation and rotation arrays
     cdef FBXGeometryLoader* loader = new FBXGeometryLoader()
-    cdef bool success = loader.loadGeometryDataFromFile(f, data)
-    #del data
-    #del loader
-    if success:
-        return convert_mesh_data_list_to_dict(data)
+    try:
+        return load_with_loader(loader, filename, use_numpy, options)
+    finally:
+        del loader
+
+cdef class FbxLoaderSession:
+    # keeps one FBX SDK manager alive across loads, the scene of each file is destroyed after
+    # its extraction and the C++ results are freed once they are no longer referenced from Python
+    cdef FBXGeometryLoader* loader
+    cdef object retained
+
+    def __cinit__(self):
+        self.loader = new FBXGeometryLoader()
+        self.retained = weakref.WeakSet()
+
+    def __dealloc__(self):
+        if self.loader != NULL:
+            del self.loader
+            self.loader = NULL
+
+    def load(self, filename, use_numpy=False, **options):
+        return load_with_loader(self.loader, filename, use_numpy, options, self.retained)
+
+    @property
+    def retained_bytes(self):
+        # C++ memory of the results of this session that are still referenced
+        return sum(obj.nbytes for obj in list(self.retained))
+
+cdef convert_mesh_arrays_to_lists(mesh_data):
+    # the layout of convert_mesh_data_to_dict built from the NumPy export of a mesh
+    result = dict(mesh_data)
+    for key in ("indices", "vertices", "normals", "texture_coordinates", "colors", "tangents"):
+        result[key] = mesh_data[key].tolist()
+    result["uv_sets"] = [uvs.tolist() for uvs in mesh_data["uv_sets"]]
+    joint_ids, weights = mesh_data["weights"]
+    result["weights"] = list(zip(joint_ids.tolist(), weights.tolist()))
+    result["lods"] = [{"ratio": lod["ratio"], "error": lod["error"], "indices": lod["indices"].tolist()} for lod in mesh_data["lods"]]
+    return result
+
+cdef class FbxFile:
+    # keeps the imported scene of a file open, lists its content without extracting it and
+    # extracts the skeleton, the meshes and windows of single takes only when they are requested
+    cdef FBXGeometryLoader* loader
+    cdef GeometryDataOwner owner
+    cdef bool import_skeleton
+    cdef bool skeleton_extracted
+    cdef object mesh_arrays
+    cdef object cache
+    cdef readonly object filename
+
+    def __cinit__(self, filename, **options):
+        self.loader = new FBXGeometryLoader()
+        self.owner = GeometryDataOwner()
+        self.owner.data_list = new GeometryDataList()
+        self.cache = dict()
+        self.filename = filename
+        cdef LoadOptions load_options = convert_dict_to_load_options(options)
+        self.import_skeleton = load_options.importSkeleton
+        cdef char* f = filename
+        if not self.loader.openFile(f, load_options):
+            raise IOError("Unable to open " + os.fsdecode(filename))
+
+    def __dealloc__(self):
+        if self.loader != NULL:
+            del self.loader
+            self.loader = NULL
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def close(self):
+        # destroys the scene, results that were already returned stay valid
+        if self.loader != NULL:
+            del self.loader
+            self.loader = NULL
+
+    cdef check_open(self):
+        if self.loader == NULL:
+            raise ValueError("FbxFile is closed")
+
+    cdef Skeleton* get_skeleton(self) except *:
+        if not self.skeleton_extracted and self.import_skeleton:
+            self.check_open()
+            self.loader.extractSkeleton(self.owner.data_list)
+            self.skeleton_extracted = True
+        return self.owner.data_list.skeleton
+
+    @property
+    def takes(self):
+        # take names mapped to their durations in seconds
+        self.check_open()
+        cdef vector[string] names
+        cdef double duration = 0
+        self.loader.getTakeNames(names)
+        takes = dict()
+        for i in range(names.size()):
+            if self.loader.getTakeDuration(names[i], duration):
+                takes[names[i].decode("utf-8")] = duration
+        return takes
+
+    @property
+    def mesh_names(self):
+        self.check_open()
+        cdef vector[string] names
+        self.loader.getMeshNames(names)
+        return [names[i].decode("utf-8") for i in range(names.size())]
+
+    @property
+    def joint_names(self):
+        cdef Skeleton* s = self.get_skeleton()
+        if s == NULL:
+            return []
+        return [s.jointOrder[i].decode("utf-8") for i in range(s.jointOrder.size())]
+
+    def skeleton(self):
+        if "skeleton" not in self.cache:
+            if self.get_skeleton() == NULL:
+                return None
+            self.cache["skeleton"] = convert_skeleton_to_dict(self.owner.data_list)
+        return self.cache["skeleton"]
+
+    def meshes(self, use_numpy=False):
+        cdef GeometryDataList* data_list = self.owner.data_list
+        if self.mesh_arrays is None:
+            # the skin weights refer to the joints of the skeleton
+            self.get_skeleton()
+            self.check_open()
+            self.loader.extractMeshes(self.owner.data_list)
+            # converted only once, because the conversion negates the normals in place and takes over the quantized buffers
+            self.mesh_arrays = [convert_mesh_data_to_arrays(data_list.meshList.at(i), self.owner) for i in range(data_list.meshList.size())]
+        if use_numpy:
+            return self.mesh_arrays
+        if "meshes" not in self.cache:
+            self.cache["meshes"] = [convert_mesh_arrays_to_lists(mesh_data) for mesh_data in self.mesh_arrays]
+        return self.cache["meshes"]
+
+    def sample(self, take, start=0.0, end=None, joints=None):
+        # samples the frames of [start, end) in seconds relative to the take start, by default
+        # of all animated nodes, and returns them with the layout of the NumPy export
+        key = ("sample", take, float(start), None if end is None else float(end), None if joints is None else tuple(joints))
+        if key in self.cache:
+            return self.cache[key]
+        cdef Skeleton* s = self.get_skeleton()
+        self.check_open()
+        cdef string take_name = take.encode("utf-8")
+        cdef double start_time = start
+        cdef double end_time = -1 if end is None else end
+        cdef vector[string] node_names
+        if joints is not None:
+            for name in joints:
+                node_names.push_back(name.encode("utf-8"))
+        cdef JointFramesMap animation
+        cdef bool sampled
+        with nogil:
+            sampled = self.loader.extractTake(take_name, start_time, end_time, node_names, s, animation)
+        if not sampled:
+            raise KeyError(take)
+        result = convert_animation_to_arrays(animation)
+        self.cache[key] = result
+        return result
+
+    def clear_cache(self):
+        self.cache.clear()
+
+_NO_FILENAME = object()
+_worker_session = None
+
+def _load_fbx_file_in_worker(filename, use_numpy, options):
+    # errors are returned instead of raised so that one broken file does not stop the batch,
+    # each process reuses one session so that the SDK is only initialized once
+    global _worker_session
+    try:
+        if _worker_session is None:
+            _worker_session = FbxLoaderSession()
+        data = _worker_session.load(os.fsencode(filename), use_numpy, **options)
+        if data is None:
+            return None, "Unable to load " + os.fsdecode(filename)
+        return data, None
+    except Exception as e:
+        return None, "%s: %s" % (type(e).__name__, e)
+
+def load_fbx_files(filenames, workers=None, max_in_flight=None, use_numpy=False, **options):
+    # imports the files in worker processes and yields (filename, data, error) in the order the files finish,
+    # data is None if error is set. At most max_in_flight files, by default twice the number of workers,
+    # are being loaded or waiting to be consumed at the same time to bound the memory use.
+    if workers is None:
+        workers = os.cpu_count() or 1
+    if max_in_flight is None:
+        max_in_flight = 2 * workers
+    max_in_flight = max(max_in_flight, workers, 1)
+    # keep the workers from competing for the cores with their own mesh and animation threads
+    options.setdefault("num_threads", max(1, (os.cpu_count() or 1) // max(workers, 1)))
+    convert_dict_to_load_options(options)
+    if workers <= 1:
+        for filename in filenames:
+            data, error = _load_fbx_file_in_worker(filename, use_numpy, options)
+            yield filename, data, error
+        return
+    filename_iter = iter(filenames)
+    retry = deque()
+    retried = set()
+    pending = dict()
+    executor = ProcessPoolExecutor(max_workers=workers)
+    try:
+        while True:
+            while len(pending) < max_in_flight:
+                if len(retry) > 0:
+                    # files retried after a crash run one at a time so that they cannot break each other
+                    if len(pending) > 0:
+                        break
+                    filename = retry.popleft()
+                else:
+                    filename = next(filename_iter, _NO_FILENAME)
+                    if filename is _NO_FILENAME:
+                        break
+                try:
+                    future = executor.submit(_load_fbx_file_in_worker, filename, use_numpy, options)
+                except BrokenProcessPool:
+                    executor.shutdown(wait=False)
+                    executor = ProcessPoolExecutor(max_workers=workers)
+                    future = executor.submit(_load_fbx_file_in_worker, filename, use_numpy, options)
+                pending[future] = (filename, executor)
+                if filename in retried:
+                    break
+            if len(pending) == 0:
+                break
+            done, _ = wait(pending, return_when=FIRST_COMPLETED)
+            for future in done:
+                filename, future_executor = pending.pop(future)
+                try:
+                    data, error = future.result()
+                except BrokenProcessPool as e:
+                    if future_executor is executor:
+                        # the broken pool has already failed all of its futures
+                        executor.shutdown(wait=False)
+                        executor = ProcessPoolExecutor(max_workers=workers)
+                    # a crashing worker fails every file in flight, so each of them is retried once in a new pool
+                    if filename not in retried:
+                        retried.add(filename)
+                        retry.append(filename)
+                        continue
+                    data, error = None, "%s: %s" % (type(e).__name__, e)
+                except Exception as e:
+                    data, error = None, "%s: %s" % (type(e).__name__, e)
+                yield filename, data, error
+    finally:
+        # also reached if the consumer stops early, files that are still loading are not waited for
+        if sys.version_info >= (3, 9):
+            executor.shutdown(wait=False, cancel_futures=True)
+        else:
+            for future in pending:
+                future.cancel()
+            executor.shutdown(wait=False)
\ No newline at end of file